@@ -0,0 +1,90 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <string>
+#include <vector>
+
+// How long an engine should search. Exactly one limit is normally set; with none the engine
+// searches for DEFAULT_MOVETIME_MS rather than until stopped. A game clock's state may be
+// given instead, leaving the engine's own time management to decide how long to think.
+struct SearchLimits {
+    static constexpr int DEFAULT_MOVETIME_MS = 1000;
+
+    int depth = 0;       // plies
+    int movetimeMs = 0;
+    long long nodes = 0;
+    long long whiteTimeMs = 0;  // time left on each clock, 0 if not playing on a clock
+    long long blackTimeMs = 0;
+    long long whiteIncMs = 0;   // added to each clock after every move
+    long long blackIncMs = 0;
+    int movesToGo = 0;          // moves until the next time control, 0 if none comes
+
+    static SearchLimits atDepth(int depth) {
+        SearchLimits limits;
+        limits.depth = depth;
+        return limits;
+    }
+    static SearchLimits forTime(int movetimeMs) {
+        SearchLimits limits;
+        limits.movetimeMs = movetimeMs;
+        return limits;
+    }
+
+    bool usesClock() const {
+        return whiteTimeMs > 0 || blackTimeMs > 0;
+    }
+
+    // No limit set at all
+    bool isEmpty() const {
+        return depth <= 0 && movetimeMs <= 0 && nodes <= 0 && !usesClock();
+    }
+
+    // These limits, or DEFAULT_MOVETIME_MS if they are empty; what the backends search with
+    SearchLimits bounded() const {
+        return isEmpty() ? forTime(DEFAULT_MOVETIME_MS) : *this;
+    }
+
+    // Arguments for the UCI "go" command (of the bounded limits, so never "infinite")
+    std::string goArguments() const {
+        if (isEmpty()) {
+            return bounded().goArguments();
+        }
+        std::string args;
+        if (depth > 0) {
+            args += " depth " + std::to_string(depth);
+        }
+        if (movetimeMs > 0) {
+            args += " movetime " + std::to_string(movetimeMs);
+        }
+        if (nodes > 0) {
+            args += " nodes " + std::to_string(nodes);
+        }
+        if (usesClock()) {
+            args += " wtime " + std::to_string(whiteTimeMs) + " btime " + std::to_string(blackTimeMs);
+            if (whiteIncMs > 0) {
+                args += " winc " + std::to_string(whiteIncMs);
+            }
+            if (blackIncMs > 0) {
+                args += " binc " + std::to_string(blackIncMs);
+            }
+            if (movesToGo > 0) {
+                args += " movestogo " + std::to_string(movesToGo);
+            }
+        }
+        return args;
+    }
+};
+
+// What a finished search found, from the side to move's point of view
+struct Analysis {
+    std::string bestMove;           // UCI notation; empty if the search failed
+    std::string ponderMove;         // the reply the engine expects, if it gave one
+    int depth = 0;                  // deepest completed iteration
+    bool mate = false;              // score is "mate in N" (negative: getting mated)...
+    int score = 0;                  // ...otherwise centipawns
+    std::vector<std::string> pv;    // principal variation, starting with bestMove
+    long long nodes = 0;            // searched, as last reported
+    int timeMs = 0;                 // spent searching, as last reported
+};
+
+#endif // ANALYSIS_H
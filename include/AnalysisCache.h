@@ -0,0 +1,104 @@
+#ifndef ANALYSISCACHE_H
+#define ANALYSISCACHE_H
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include "Analysis.h"
+#include "MappedFile.h"
+
+// Engine results by position, so a position searched before (the common openings, mostly)
+// is answered without asking an engine. Recent results live in an LRU list in memory;
+// behind it is a hash table in a memory-mapped file that keeps results across restarts.
+//
+// A result is filed under the position (the FEN without its move clocks) and the kind of
+// limit it was searched with, and it answers any later request of that kind it meets: a
+// depth 20 result answers requests for depth 20 or less, a 1000 ms one requests for up to
+// 1000 ms. Searches on a game clock are neither answered nor stored; look them up as a
+// fixed-time search instead. The game history leading to the position is not part of the
+// key, so a cached move can walk into a repetition the engine would have seen.
+//
+// Safe to share between threads.
+class AnalysisCache {
+public:
+    // `capacity` results are kept in memory. With a file path, `fileSlots` (rounded up to a
+    // power of two) results fit in the file; without one the cache is memory only.
+    explicit AnalysisCache(size_t capacity = 4096, const std::string& path = "", size_t fileSlots = 1 << 16);
+    ~AnalysisCache();
+
+    AnalysisCache(const AnalysisCache&) = delete;
+    AnalysisCache& operator=(const AnalysisCache&) = delete;
+
+    // A stored result for the position that meets `limits`. Fills `analysis` and returns true
+    // on a hit.
+    bool lookup(const std::string& fen, const SearchLimits& limits, Analysis& analysis);
+
+    // Remember the result of a search of `fen` with `limits`. Replaces an earlier result only
+    // if the new one searched at least as far.
+    void store(const std::string& fen, const SearchLimits& limits, const Analysis& analysis);
+
+    // Whether the file tier is in use
+    bool isPersistent() const {
+        return file.isOpen();
+    }
+
+    // Write the file tier out to disk now
+    void flush();
+
+    uint64_t getHits() const;
+    uint64_t getMisses() const;
+
+    // The FEN fields that identify a position: placement, side, castling and en passant
+    static std::string normalizeFEN(const std::string& fen);
+
+private:
+    static constexpr int MAX_PV = 12;     // moves of the PV kept in the file
+    static constexpr int PROBE_SLOTS = 4; // file slots a key may occupy
+
+    // One result as laid out in the file
+    struct Record {
+        uint64_t key;                     // 0: slot unused
+        uint32_t budget;                  // plies, ms or thousands of nodes searched for
+        int32_t score;
+        uint16_t depth;
+        uint8_t mate;
+        uint8_t pvLength;
+        char pv[MAX_PV][6];               // NUL-terminated UCI moves, pv[0] the best move
+        char ponderMove[6];
+        char reserved[2];
+    };
+    static_assert(std::is_trivially_copyable<Record>::value, "records are copied to and from the file raw");
+
+    struct Entry {
+        uint32_t budget;
+        Analysis analysis;
+    };
+    using LruList = std::list<std::pair<uint64_t, Entry>>;
+
+    static uint64_t keyFor(const std::string& fen, const SearchLimits& limits);
+    static uint32_t budgetOf(const SearchLimits& limits);
+
+    // file tier
+    bool openFile(const std::string& path, size_t slots);
+    Record* findRecord(uint64_t key);
+    void writeRecord(uint64_t key, uint32_t budget, const Analysis& analysis);
+
+    // memory tier
+    Entry* findEntry(uint64_t key);
+    void insertEntry(uint64_t key, const Entry& entry);
+
+    const size_t capacity;
+    LruList lru;                                            // most recently used first
+    std::unordered_map<uint64_t, LruList::iterator> index;
+    MappedFile file;
+    Record* records = nullptr;
+    size_t slotMask = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    mutable std::mutex mutex;
+};
+
+#endif // ANALYSISCACHE_H
@@ -0,0 +1,114 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#define USE_PEXT
+#endif
+
+// A set of squares, one bit per square. Square index is row * 8 + col (A1 = 0, H8 = 63),
+// the same numbering used by Position(int) and Board::changedPositions.
+using Bitboard = uint64_t;
+
+namespace Bitboards {
+
+constexpr Bitboard FileA = 0x0101010101010101ULL;
+constexpr Bitboard FileH = FileA << 7;
+constexpr Bitboard Rank1 = 0xFFULL;
+constexpr Bitboard Rank8 = Rank1 << 56;
+
+// Leaper attack tables, filled by init()
+extern Bitboard knightAttacks[64];
+extern Bitboard kingAttacks[64];
+extern Bitboard pawnAttacks[2][64]; // indexed by static_cast<int>(Color)
+
+// Squares strictly between two squares on a common rank, file or diagonal (0 otherwise),
+// and the whole line through them including both ends (0 if not aligned)
+extern Bitboard betweenBB[64][64];
+extern Bitboard lineBB[64][64];
+
+// Sliding attack lookup for one square. The relevant blockers (mask) are hashed into an index
+// into that square's slice of the attack table: with PEXT on BMI2 builds, otherwise by a magic
+// multiply and shift found at startup.
+struct Magic {
+    Bitboard mask;
+    Bitboard magic;
+    Bitboard* attacks;
+    unsigned shift;
+
+    unsigned index(Bitboard occupied) const {
+#ifdef USE_PEXT
+        return static_cast<unsigned>(_pext_u64(occupied, mask));
+#else
+        return static_cast<unsigned>(((occupied & mask) * magic) >> shift);
+#endif
+    }
+};
+
+extern Magic rookMagics[64];
+extern Magic bishopMagics[64];
+
+// Build the attack tables. Safe to call more than once; only the first call does any work.
+void init();
+
+// Sliding attacks from a square given the occupied squares (blockers are included)
+inline Bitboard rookAttacks(int square, Bitboard occupied) {
+    const Magic& m = rookMagics[square];
+    return m.attacks[m.index(occupied)];
+}
+inline Bitboard bishopAttacks(int square, Bitboard occupied) {
+    const Magic& m = bishopMagics[square];
+    return m.attacks[m.index(occupied)];
+}
+inline Bitboard queenAttacks(int square, Bitboard occupied) {
+    return rookAttacks(square, occupied) | bishopAttacks(square, occupied);
+}
+
+inline Bitboard squareBB(int square) {
+    return 1ULL << square;
+}
+
+// The bit scans map to one instruction on GCC/Clang and on MSVC for x64; other MSVC targets
+// fall back to plain arithmetic
+inline int popcount(Bitboard b) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    return static_cast<int>(__popcnt64(b));
+#elif defined(_MSC_VER)
+    b = b - ((b >> 1) & 0x5555555555555555ULL);
+    b = (b & 0x3333333333333333ULL) + ((b >> 2) & 0x3333333333333333ULL);
+    b = (b + (b >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<int>((b * 0x0101010101010101ULL) >> 56);
+#else
+    return __builtin_popcountll(b);
+#endif
+}
+
+// Index of the least significant set bit; b must not be empty
+inline int lsb(Bitboard b) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, b);
+    return static_cast<int>(index);
+#elif defined(_MSC_VER)
+    return popcount((b & (0 - b)) - 1);
+#else
+    return __builtin_ctzll(b);
+#endif
+}
+
+// Remove and return the least significant set bit; b must not be empty
+inline int popLsb(Bitboard& b) {
+    int square = lsb(b);
+    b &= b - 1;
+    return square;
+}
+
+} // namespace Bitboards
+
+#endif // BITBOARD_H
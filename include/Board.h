@@ -1,18 +1,77 @@
 #ifndef BOARD_H
 #define BOARD_H
 
+#include <array>
 #include <vector>
+#include "Bitboard.h"
+#include "Zobrist.h"
 #include "Piece.h"
 #include "Move.h"
+#include "MoveList.h"
+#include "PieceArena.h"
 #include <memory>
 #include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+enum CastlingRights : uint8_t {
+    NO_CASTLING = 0,
+    WHITE_OO = 1,
+    WHITE_OOO = 2,
+    BLACK_OO = 4,
+    BLACK_OOO = 8,
+    ALL_CASTLING = 15
+};
+
+// The whole position in 80 bytes, without the move history. Trivially copyable, so handing a
+// position to another thread is a memcpy; each worker builds its own Board from it.
+struct BoardSnapshot {
+    Bitboard byType[6];
+    Bitboard byColor[2];
+    uint64_t key;
+    uint16_t halfmoveClock;
+    uint16_t fullmoveNumber;
+    int8_t epSquare;
+    uint8_t castlingRights;
+    uint8_t sideToMove;     // static_cast<uint8_t>(Color)
+};
+static_assert(std::is_trivially_copyable<BoardSnapshot>::value, "BoardSnapshot must be memcpy-able");
+static_assert(sizeof(BoardSnapshot) <= 128, "BoardSnapshot should fit in two cache lines");
+
+// Squares changed by the last movePiece, each with the pieceTypeWithColor (as an int) now on
+// it. A move changes at most four squares (castling), so the list has fixed room and copying a
+// board never allocates for it.
+class SquareChanges {
+public:
+    static constexpr int Capacity = 4;
+
+    void emplace_back(std::pair<int, int> change) {
+        if (count == Capacity) {
+            throw std::length_error("more than 4 changed squares");
+        }
+        changes[count++] = change;
+    }
+
+    void clear() { count = 0; }
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    const std::pair<int, int>& operator[](int i) const { return changes[i]; }
+    const std::pair<int, int>* begin() const { return changes; }
+    const std::pair<int, int>* end() const { return changes + count; }
+
+private:
+    std::pair<int, int> changes[Capacity];
+    int count = 0;
+};
 
 class Board {
 public:
     std::shared_ptr<Piece> whiteKing;
     std::shared_ptr<Piece> blackKing;
-    std::vector<std::vector<std::shared_ptr<Piece>>> board;
-    std::vector<std::string> stringBoard = {
+    std::array<std::array<std::shared_ptr<Piece>, 8>, 8> board;
+    std::array<std::string, 64> stringBoard = {
         "wr", "wn", "wb", "wq", "wk", "wb", "wn", "wr",
         "wp", "wp", "wp", "wp", "wp", "wp", "wp", "wp",
         "", "", "", "", "", "", "", "",
@@ -22,7 +81,7 @@ public:
         "bp", "bp", "bp", "bp", "bp", "bp", "bp", "bp",
         "br", "bn", "bb", "bq", "bk", "bb", "bn", "br"
     };
-    std::vector<std::pair<int, int>> changedPositions;
+    SquareChanges changedPositions;
     std::string piece2string(std::shared_ptr<Piece> piece) const {
         if (piece == nullptr) {
             return "  ";
@@ -44,33 +103,103 @@ public:
         }
         return color + type;
     }
-    std::vector<std::shared_ptr<Piece>> whitePieces;
-    std::vector<std::shared_ptr<Piece>> blackPieces;
-    std::vector<Move*> moves;
+    PieceList whitePieces;
+    PieceList blackPieces;
     Color sideToMove;
     bool isInCheck = false;
 
+    // Bitboard core. These are authoritative: move generation, check detection and FEN export
+    // read only from here. The shared_ptr grid and piece lists above are kept in sync as a
+    // compatibility layer for code that works with Piece objects; the pieces come from
+    // PieceArena, so building that layer doesn't allocate once the thread's pool is warm.
+    Bitboard byType[6] = {};        // indexed by PieceType
+    Bitboard byColor[2] = {};       // indexed by Color
+    pieceTypeWithColor mailbox[64]; // piece on each square, pieceTypeWithColor::empty if none
+    uint8_t castlingRights = NO_CASTLING;
+    int epSquare = -1;              // square a pawn can capture onto en passant, -1 if none
+    int halfmoveClock = 0;          // plies since the last capture or pawn move
+    int fullmoveNumber = 1;         // starts at 1, incremented after each black move
+    uint64_t key = 0;               // Zobrist key, updated incrementally by every change above
+
+    // Undo record for one played move: the move plus whatever it destroyed. The keys also
+    // serve as the position history for repetition detection.
+    struct StateInfo {
+        uint64_t key;                   // key before the move
+        PackedMove move;
+        pieceTypeWithColor captured;    // pieceTypeWithColor::empty if nothing was captured
+        uint8_t castlingRights;
+        int8_t epSquare;
+        uint16_t halfmoveClock;
+    };
+    // Squares attacked by each color (indexed by Color). Only kept current while attack
+    // tracking is on; see setAttackTracking.
+    Bitboard attackMap[2] = {};
+    Bitboard attacksFrom[64] = {};  // squares attacked by the piece on each square, 0 if empty
+    bool trackAttacks = false;
+
+    // Longest game the history can hold, in plies. The limit is deliberate: a fixed array
+    // keeps boards allocation-free to create and copy, and the longest recorded game is under
+    // 600 plies. Legal games can in theory run longer; past the limit movePiece refuses moves.
+    static constexpr int MAX_PLIES = 1024;
+    StateInfo history[MAX_PLIES];
+    int historySize = 0;
+
     // Constructor
     Board();
 
+    // Copies get their own Piece objects, rebuilt from the core; no allocation once the
+    // thread's piece pool is warm
+    Board(const Board& other);
+    Board& operator=(const Board& other);
+
+    // Build a board from a snapshot (see loadSnapshot)
+    explicit Board(const BoardSnapshot& snapshot);
+
     // Destructor
     ~Board();
 
     // Initialize the board with pieces in the starting positions
     void initialize();
 
+    // Set up the board from a FEN string, discarding the move history.
+    // Returns false (leaving the board empty) if the placement field is malformed.
+    bool loadFEN(const std::string& fen);
+
+    // FEN of the position the move history starts from (set by loadFEN, initialize and
+    // loadSnapshot), and the moves played since in UCI notation. Together they describe the
+    // game the way "position fen ... moves ..." does.
+    std::string getRootFEN() const;
+    std::vector<std::string> uciMoves() const;
+
+    // Capture the current position, or set it up from a capture. Loading discards the move
+    // history, so repetitions of positions before the snapshot are not detected.
+    BoardSnapshot snapshot() const;
+    void loadSnapshot(const BoardSnapshot& snapshot);
+
     // Print the board (for debugging purposes)
     void printBoard() const;
 
     // Move a piece from one position to another
     enum class MoveType { FAILED, NORMAL, CASTLING, PROMOTION };
-    bool movePiece(Position from, Position to, bool safetyCheck = true, bool undo = false);
+    bool movePiece(Position from, Position to, bool safetyCheck = true,
+                   PieceType promotionType = PieceType::QUEEN);
     bool undoMove();
 
+    // Play or take back a legal move on the bitboard core only. Much cheaper than
+    // movePiece/undoMove since no Piece objects are touched, so the shared_ptr accessors are
+    // stale until every makeMove has been unmade. Intended for search and perft.
+    // makeMove throws std::length_error if the history already holds MAX_PLIES moves.
+    void makeMove(PackedMove move);
+    void unmakeMove();
+
+    // The PackedMove movePiece would play for from -> to (flags are derived from the position)
+    PackedMove toPackedMove(int from, int to, PieceType promotionType = PieceType::QUEEN) const;
+
     // Get the piece at a specific position
     std::shared_ptr<Piece> getPiece(Position pos) const;
 
-    // Add a piece to a specific position
+    // Add a piece to a specific position. Throws std::length_error (leaving the board as it
+    // was) if its color already has 16 pieces.
     void addPiece(std::shared_ptr<Piece> piece, Position pos);
 
     // Remove a piece from a specific position
@@ -85,9 +214,96 @@ public:
     // Check if a move puts the player in check
     bool isCheck(Color color) const;
 
+    // Bitboard core accessors
+    Bitboard occupied() const {
+        return byColor[0] | byColor[1];
+    }
+    Bitboard pieces(Color color, PieceType type) const {
+        return byColor[static_cast<int>(color)] & byType[static_cast<int>(type)];
+    }
+    pieceTypeWithColor pieceOn(int square) const {
+        return mailbox[square];
+    }
+    // Square of the king of the given color, -1 if there is none
+    int kingSquare(Color color) const {
+        Bitboard king = pieces(color, PieceType::KING);
+        return king ? Bitboards::lsb(king) : -1;
+    }
+
+    // Pieces of either color attacking a square, with sliders blocked by `occupied`
+    Bitboard attackersTo(int square, Bitboard occupied) const;
+
+    // Whether any piece of the attacker's color attacks the square. A lookup in attackMap while attack
+    // tracking is on, otherwise leaper tables first and then the sliding rays.
+    bool isSquareAttacked(int square, Color attacker) const;
+
+    // Every square attacked by the given color (e.g. for threat highlighting)
+    Bitboard attackedSquares(Color attacker) const;
+
+    // Keep attackMap up to date on every move, which makes isSquareAttacked, isCheck and
+    // attackedSquares O(1). Worth it when those are queried after most moves, as the game
+    // does; search and perft leave it off.
+    void setAttackTracking(bool enabled);
+    // Recompute every piece's attacks (after the whole position changed)
+    void refreshAttackMaps();
+
+    // Whether moving the piece on `from` to `to` (capturing on captureSquare, -1 for none)
+    // leaves its own king safe. Does not modify the board.
+    bool isLegal(int from, int to, int captureSquare) const;
+
+    // Check and pin information for one side, computed once per position by the legal generator
+    struct CheckInfo {
+        int kingSquare;
+        Bitboard checkers;  // enemy pieces giving check
+        Bitboard checkMask; // squares a non-king move must land on to address the check
+        Bitboard pinned;    // own pieces pinned to the king; they may only move along the pin line
+    };
+    CheckInfo checkInfo(Color color) const;
+
+    // Call emit(from, to, captureSquare, isCastling) for every legal move of `color` whose
+    // origin square is in fromMask (captureSquare is -1 for quiet moves). Promotions are
+    // emitted once; callers expand them. Does not modify the board.
+    template <typename Emit>
+    void generateLegalMoves(Color color, Bitboard fromMask, Emit&& emit) const;
+
+    // Destination squares of the legal moves of the piece on a square
+    Bitboard legalTargets(int from) const;
+
+    // All legal moves for `color`, written into a caller-provided buffer. Like every const
+    // member of Board this only reads the position, so concurrent callers need no locking.
+    void generateLegalMoves(Color color, MoveList& moveList) const;
+
+    // Place or clear a piece in the bitboard core only
+    void putPiece(pieceTypeWithColor piece, int square);
+    void clearSquare(int square);
+
+    // Update the shared_ptr grid (and the piece's own position) or the piece lists only
+    void setGridPiece(int square, std::shared_ptr<Piece> piece);
+    void unlistPiece(std::shared_ptr<Piece> piece);
+
+    // Recreate the grid, piece lists and stringBoard from the core
+    void rebuildPieces();
+
     // Check if the current player is in checkmate
     bool isCheckmate(Color color) const;
 
+    // Zobrist key of the current position (pieces, side to move, castling rights, en passant)
+    uint64_t getKey() const {
+        return key;
+    }
+
+    // Key of the current position in the Polyglot opening book format. Computed from scratch,
+    // as it is only needed once per book probe.
+    uint64_t polyglotKey() const;
+
+    // How many times the current position occurred earlier in the game. Only positions since
+    // the last capture or pawn move are scanned, since none before it can repeat.
+    int repetitionCount() const;
+
+    bool isThreefoldRepetition() const {
+        return repetitionCount() >= 2;
+    }
+
     // Get the current side to move
     Color getSideToMove() const;
     Color getOppositeColor() const {
@@ -118,50 +334,18 @@ public:
         return isInCheck;
     }
 
-    std::string toFEN() const {
-        std::stringstream fen;
-        
-        // Board position
-        for (int row = 7; row >= 0; --row) {
-            int emptyCount = 0;
-            for (int col = 0; col < 8; ++col) {
-                auto piece = getPiece(Position(row, col));
-                if (piece) {
-                    if (emptyCount > 0) {
-                        fen << emptyCount;
-                        emptyCount = 0;
-                    }
-                    fen << piece->getFENChar();
-                } else {
-                    ++emptyCount;
-                }
-            }
-            if (emptyCount > 0) {
-                fen << emptyCount;
-            }
-            if (row > 0) {
-                fen << '/';
-            }
-        }
+    // FEN of the current position, clocks included
+    std::string toFEN() const;
 
-        // Side to move
-        fen << (sideToMove == Color::WHITE ? " w" : " b");
-
-        // Castling rights (this is a placeholder, you should implement proper castling rights tracking)
-        fen << " KQkq";
-
-        // En passant target square (this is a placeholder, you should implement en passant tracking)
-        fen << " -";
-
-        // Halfmove clock (this is a placeholder, you should implement halfmove clock)
-        fen << " 0";
-
-        // Fullmove number (this is a placeholder, you should implement fullmove number tracking)
-        fen << " 1";
-
-        return fen.str();
-    }
+private:
+    // Squares the piece on `square` attacks, sliders blocked by `occupied`
+    Bitboard pieceAttacks(int square, Bitboard occupied) const;
+    // Bring the attack maps up to date after the occupants of `changed` changed: only the
+    // pieces on those squares and the sliders whose rays reached one of them are recomputed
+    void updateAttackMaps(Bitboard changed);
 
+    // The position history[0] was played from
+    BoardSnapshot root{};
 };
 
 #endif // BOARD_H
@@ -0,0 +1,35 @@
+#ifndef ENGINEBACKEND_H
+#define ENGINEBACKEND_H
+
+#include <cstdlib>
+#include <string>
+
+// The engine implementation the programs are built with: Stockfish in-process when
+// CHESS_INPROCESS_STOCKFISH is defined, otherwise a Stockfish child process
+#ifdef CHESS_INPROCESS_STOCKFISH
+#include "InProcessStockfish.h"
+using EngineBackend = InProcessStockfish;
+
+// Directory holding the networks: $STOCKFISH_NNUE_DIR if set, otherwise the built-in search path
+inline std::string defaultEngineLocation() {
+    const char* dir = std::getenv("STOCKFISH_NNUE_DIR");
+    return dir ? dir : "";
+}
+#else
+#include "StockfishWrapper.h"
+using EngineBackend = StockfishWrapper;
+
+// Engine binary: $STOCKFISH_PATH if set, otherwise the platform default
+inline std::string defaultEngineLocation() {
+    if (const char* path = std::getenv("STOCKFISH_PATH")) {
+        return path;
+    }
+#ifdef _WIN32
+    return "C:\\Users\\simon\\Documents\\Chess\\external\\Stockfish\\build\\bin\\stockfish.exe";
+#else
+    return "stockfish"; // looked up in PATH
+#endif
+}
+#endif
+
+#endif // ENGINEBACKEND_H
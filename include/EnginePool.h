@@ -0,0 +1,237 @@
+#ifndef ENGINEPOOL_H
+#define ENGINEPOOL_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// A fixed set of engine instances shared by many games. A game checks an engine out for each
+// search and gets the same one back next time if it is free, so the engine's hash table stays
+// warm for that game. An engine handed to a different game is sent ucinewgame first.
+// Requests that find every engine busy wait in a bounded FIFO queue.
+//
+// Engine needs a newGame() method; StockfishWrapper and InProcessStockfish both have one.
+template <typename Engine>
+class EnginePool {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Factory = std::function<std::unique_ptr<Engine>()>;
+
+    struct Metrics {
+        uint64_t checkouts = 0;      // requests that got an engine
+        uint64_t affinityHits = 0;   // ...and got the same engine as the game's previous request
+        uint64_t newGames = 0;       // engines reassigned to another game (ucinewgame sent)
+        uint64_t rejected = 0;       // requests turned away because the queue was full
+        uint64_t timedOut = 0;       // requests that gave up waiting
+        uint64_t waited = 0;         // requests that had to queue
+        Clock::duration totalWait{}; // summed over every checkout
+        Clock::duration maxWait{};
+        size_t queueLength = 0;      // requests waiting right now
+        size_t busy = 0;             // engines checked out right now
+    };
+
+    // Exclusive use of one engine; returned to the pool when the lease goes away.
+    // An empty lease (operator bool false) means the request was rejected or timed out.
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept : pool(other.pool), index(other.index) {
+            other.pool = nullptr;
+        }
+        Lease& operator=(Lease&& other) noexcept {
+            if (this != &other) {
+                release();
+                pool = other.pool;
+                index = other.index;
+                other.pool = nullptr;
+            }
+            return *this;
+        }
+        ~Lease() {
+            release();
+        }
+
+        explicit operator bool() const {
+            return pool != nullptr;
+        }
+        Engine& operator*() const {
+            return *pool->slots[index].engine;
+        }
+        Engine* operator->() const {
+            return pool->slots[index].engine.get();
+        }
+
+        // Hand the engine back before the lease is destroyed
+        void release() {
+            if (pool) {
+                pool->checkin(index);
+                pool = nullptr;
+            }
+        }
+
+    private:
+        friend class EnginePool;
+        Lease(EnginePool* pool, size_t index) : pool(pool), index(index) {}
+
+        EnginePool* pool = nullptr;
+        size_t index = 0;
+    };
+
+    // Start `size` engines from the factory. At most maxQueue requests wait for one at a time.
+    EnginePool(size_t size, const Factory& factory, size_t maxQueue = 64) : maxQueue(maxQueue) {
+        slots.resize(std::max<size_t>(size, 1));
+        for (Slot& slot : slots) {
+            slot.engine = factory();
+        }
+    }
+
+    // Leases must not outlive the pool
+    ~EnginePool() = default;
+
+    EnginePool(const EnginePool&) = delete;
+    EnginePool& operator=(const EnginePool&) = delete;
+
+    // Check out an engine for a search in the given game, waiting up to `timeout` for one
+    Lease checkout(uint64_t gameId, Clock::duration timeout = std::chrono::hours(24)) {
+        const Clock::time_point start = Clock::now();
+        std::unique_lock<std::mutex> lock(mutex);
+
+        // a newcomer may only jump the queue for its own engine
+        size_t index = pick(gameId, queue.empty());
+        if (index == NONE) {
+            if (queue.size() >= maxQueue) {
+                ++metrics.rejected;
+                return Lease();
+            }
+            const uint64_t ticket = nextTicket++;
+            queue.push_back(ticket);
+            ++metrics.waited;
+            bool granted = available.wait_until(lock, start + timeout, [&] {
+                index = pick(gameId, queue.front() == ticket);
+                return index != NONE;
+            });
+            queue.erase(std::find(queue.begin(), queue.end(), ticket));
+            // whoever is now at the front may be able to go
+            available.notify_all();
+            if (!granted) {
+                ++metrics.timedOut;
+                return Lease();
+            }
+        }
+
+        Slot& slot = slots[index];
+        const bool sameGame = slot.gameId == gameId && slot.used;
+        slot.busy = true;
+        if (!sameGame) {
+            auto previous = affinity.find(slot.gameId);
+            if (slot.used && previous != affinity.end() && previous->second == index) {
+                affinity.erase(previous);
+            }
+            slot.gameId = gameId;
+            affinity[gameId] = index;
+        }
+        const bool reassigned = !sameGame && slot.used;
+        slot.used = true;
+
+        const Clock::duration wait = Clock::now() - start;
+        ++metrics.checkouts;
+        metrics.affinityHits += sameGame;
+        metrics.newGames += reassigned;
+        metrics.totalWait += wait;
+        metrics.maxWait = std::max(metrics.maxWait, wait);
+        lock.unlock();
+
+        // the new game must not inherit the previous one's search state (if this throws, the
+        // lease still hands the engine back)
+        Lease lease(this, index);
+        if (reassigned) {
+            slot.engine->newGame();
+        }
+        return lease;
+    }
+
+    // The game is over: its engine no longer needs to be kept for it
+    void endGame(uint64_t gameId) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = affinity.find(gameId);
+        if (it != affinity.end()) {
+            slots[it->second].lastUse = Clock::time_point();
+            affinity.erase(it);
+        }
+    }
+
+    Metrics getMetrics() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        Metrics snapshot = metrics;
+        snapshot.queueLength = queue.size();
+        snapshot.busy = static_cast<size_t>(std::count_if(slots.begin(), slots.end(), [](const Slot& s) { return s.busy; }));
+        return snapshot;
+    }
+
+    size_t size() const {
+        return slots.size();
+    }
+
+private:
+    static constexpr size_t NONE = static_cast<size_t>(-1);
+
+    struct Slot {
+        std::unique_ptr<Engine> engine;
+        bool busy = false;
+        bool used = false;          // has served a game since the pool started
+        uint64_t gameId = 0;        // game the engine's state belongs to, if used
+        Clock::time_point lastUse;  // when it was last checked in
+    };
+
+    // Engine for the game: its previous engine if that one is idle, otherwise (only when it is
+    // this request's turn) the idle engine that has gone unused the longest. NONE if neither.
+    size_t pick(uint64_t gameId, bool mayTakeOther) const {
+        auto it = affinity.find(gameId);
+        if (it != affinity.end() && !slots[it->second].busy) {
+            return it->second;
+        }
+        if (!mayTakeOther) {
+            return NONE;
+        }
+        size_t best = NONE;
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (slots[i].busy) {
+                continue;
+            }
+            if (best == NONE || !slots[i].used || (slots[best].used && slots[i].lastUse < slots[best].lastUse)) {
+                best = i;
+                if (!slots[i].used) {
+                    break;
+                }
+            }
+        }
+        return best;
+    }
+
+    void checkin(size_t index) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slots[index].busy = false;
+            slots[index].lastUse = Clock::now();
+        }
+        available.notify_all();
+    }
+
+    std::vector<Slot> slots;
+    std::unordered_map<uint64_t, size_t> affinity; // game -> engine holding its state
+    std::deque<uint64_t> queue;                    // tickets of waiting requests, oldest first
+    uint64_t nextTicket = 0;
+    const size_t maxQueue;
+    Metrics metrics;
+    mutable std::mutex mutex;
+    std::condition_variable available;
+};
+
+#endif // ENGINEPOOL_H
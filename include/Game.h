@@ -4,11 +4,28 @@
 
 #include "Board.h"
 #include <string.h>
-#include "StockfishWrapper.h"
+#include "EngineBackend.h"
+#include "EnginePool.h"
+#include "AnalysisCache.h"
+#include "PolyglotBook.h"
+#include "GameClock.h"
+#include <atomic>
+#include <memory>
 
 class Game {
 public:
-    StockfishWrapper stockfish;
+    using EnginePoolType = EnginePool<EngineBackend>;
+
+    // Engines this game borrows from; shared with other games when given to the constructor
+    std::shared_ptr<EnginePoolType> engines;
+    // Results of earlier searches, consulted before asking an engine (may be null)
+    std::shared_ptr<AnalysisCache> analysisCache;
+    // Opening book, consulted before the cache and the engines (may be null)
+    std::shared_ptr<PolyglotBook> book;
+    // Plies from the start of the game during which the book is used, and how it picks a move
+    int maxBookPlies = 20;
+    PolyglotBook::Selection bookSelection = PolyglotBook::Selection::WEIGHTED;
+    uint64_t gameId;
     Board board;
     int startGrid = -1;
     int destGrid = -1;
@@ -18,9 +35,33 @@ public:
     Position to;
     std::shared_ptr<Piece> selectedPiece;
     bool successfulMove = false;
+    // Both players' clocks. On a timed game the engine is given the clocks and manages its
+    // own time; untimed, it thinks for a second a move.
+    GameClock clock;
+    // Let the engine think on the predicted reply while the player chooses a move. The engine
+    // stays checked out for the whole of the player's turn, so turn this off for games that
+    // share a small pool.
+    bool ponder = true;
 
+    // A game with a one-engine pool, an analysis cache and an opening book of its own
     Game();
+    // A game drawing on a pool, a cache and a book shared with other games
+    explicit Game(std::shared_ptr<EnginePoolType> engines, std::shared_ptr<AnalysisCache> analysisCache = nullptr,
+                  std::shared_ptr<PolyglotBook> book = nullptr);
     ~Game();
+
+    // Start an engine the way the game's own pool does (for building shared pools)
+    static std::unique_ptr<EngineBackend> createEngine();
+    // The cache the game's own constructor uses, kept in $CHESS_ANALYSIS_CACHE (default
+    // analysis.cache; an empty value keeps it in memory only)
+    static std::shared_ptr<AnalysisCache> createAnalysisCache();
+    // The book the game's own constructor uses, from $CHESS_BOOK (default book.bin); null
+    // if there is no such file
+    static std::shared_ptr<PolyglotBook> createOpeningBook();
+    // The time control games start with: $CHESS_TIME_CONTROL in PGN TimeControl form, e.g.
+    // "300+3", or "300d5"/"300b5" for a simple/Bronstein delay. Untimed if it isn't set, and the
+    // engine then thinks for a second a move.
+    static TimeControl createTimeControl();
     void startGame();
     void switchPlayer();
     bool isGameOver();
@@ -29,6 +70,10 @@ public:
     void processInput(std::string input);
     void processInput(int input);
     std::string boardToFEN(); // Convert the current board state to FEN
+
+private:
+    EnginePoolType::Lease ponderingEngine; // holds the engine while it ponders
+    std::string predictedMove;             // the move it is pondering on
 };
 
 #endif // GAME_H
@@ -0,0 +1,102 @@
+#ifndef GAMECLOCK_H
+#define GAMECLOCK_H
+
+#include <chrono>
+#include <string>
+#include "Analysis.h"
+#include "Piece.h"
+
+// How much time each side gets
+struct TimeControl {
+    enum class Delay {
+        NONE,
+        SIMPLE,     // the clock waits delayMs before it starts running down each move
+        BRONSTEIN   // after each move, the time it took is given back, up to delayMs
+    };
+
+    long long baseMs = 0;       // per side at the start (and again every movesPerPeriod moves); 0: untimed
+    long long incrementMs = 0;  // added after every move (Fischer)
+    long long delayMs = 0;
+    Delay delay = Delay::NONE;
+    int movesPerPeriod = 0;     // moves per time control period, 0 if the base is for the whole game
+
+    bool isTimed() const {
+        return baseMs > 0;
+    }
+
+    // Parse a PGN TimeControl tag: "300+2" (seconds plus increment), "40/5400" (moves per
+    // period / seconds), "40/5400+30", or "-" for untimed. As an extension, "300d5" gives a
+    // 5 second simple delay and "300b5" a 5 second Bronstein delay instead of an increment.
+    // Returns false on anything else.
+    static bool parse(const std::string& text, TimeControl& control);
+};
+
+// Both players' clocks. Runs on the monotonic clock, so changes to the system time don't
+// give or take anyone's time.
+class GameClock {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit GameClock(const TimeControl& control = TimeControl());
+
+    // Set both clocks back to the start of a game under `control`, stopped
+    void reset(const TimeControl& control);
+
+    const TimeControl& getControl() const {
+        return control;
+    }
+
+    // Start `side`'s clock (the first move of the game, or after stop)
+    void start(Color side);
+
+    // `side` to move finished its move: charge it the time taken, credit increment and delay,
+    // and start the opponent's clock. Returns false if the side ran out of time first; its
+    // clock then reads 0 and stays flagged.
+    bool press();
+
+    // Stop the running clock, charging the side to move for the time so far
+    void stop();
+
+    bool isRunning() const {
+        return running;
+    }
+    // Whose clock is running (or ran last)
+    Color getTurn() const {
+        return turn;
+    }
+
+    // Time left on a side's clock right now, including the running move; never negative
+    long long remainingMs(Color side) const;
+
+    // Whether the side has run out of time (always false for an untimed game)
+    bool isFlagged(Color side) const;
+
+    // The clocks in the form an engine's "go" command takes, for a search with `side` to move.
+    // The engine's time management then decides how long to think; delays are passed as
+    // increment, since both are time the move may use without losing any.
+    SearchLimits searchLimits(Color side) const;
+
+    // A rough share of `side`'s remaining time for one move, for comparing with results of
+    // fixed-time searches
+    long long typicalMoveTimeMs(Color side) const;
+
+    // "4:59.2" style display of a clock
+    static std::string format(long long ms);
+
+private:
+    // Time used on the current move so far
+    long long elapsedMs() const;
+    // What the running move costs the side to move if it ended after elapsed ms
+    long long chargeFor(long long elapsed) const;
+    int movesToGo(Color side) const;
+
+    TimeControl control;
+    long long remaining[2];     // indexed by Color, as of the start of the current move
+    int movesMade[2];
+    bool flagged[2];
+    bool running = false;
+    Color turn = Color::WHITE;
+    Clock::time_point moveStart;
+};
+
+#endif // GAMECLOCK_H
@@ -0,0 +1,289 @@
+#ifndef INPROCESSSTOCKFISH_H
+#define INPROCESSSTOCKFISH_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "Analysis.h"
+#include "UciParser.h"
+
+// engine.h brings in Stockfish's bitboard.h and position.h; they're not named here since our
+// Bitboard.h and Position.h would shadow them on case-insensitive file systems
+#include "engine.h"
+#include "evaluate.h"
+#include "misc.h"
+#include "search.h"
+
+// Same interface as StockfishWrapper, but the engine runs inside this process: searches are
+// started through Stockfish::Engine and results come back through its callbacks, so there
+// is no process to spawn, no pipe round-trip and no UCI text to parse.
+//
+// The networks are not embedded in the library. They are loaded from networkDirectory (which
+// must hold the default-named .nnue files) or from STOCKFISH_NNUE_DIRECTORY given at build
+// time; searching without them makes Stockfish exit.
+class InProcessStockfish {
+public:
+    explicit InProcessStockfish(const std::string &networkDirectory = "") {
+        initTables();
+        m_engine = std::make_unique<Stockfish::Engine>();
+
+        if (!networkDirectory.empty()) {
+            std::string dir = networkDirectory;
+            if (dir.back() != '/' && dir.back() != '\\') {
+                dir += '/';
+            }
+            m_engine->get_options()["EvalFile"] = dir + EvalFileDefaultNameBig;
+            m_engine->get_options()["EvalFileSmall"] = dir + EvalFileDefaultNameSmall;
+        }
+
+        m_engine->set_on_update_full([this](const Stockfish::Engine::InfoFull &info) {
+            // only the search thread gets here, so m_info needs no lock
+            toUciInfo(info, m_info);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_analysis.nodes = static_cast<long long>(m_info.nodes);
+                m_analysis.timeMs = m_info.timeMs;
+            }
+            if (m_info.multiPv == 1 && !m_info.lowerBound && !m_info.upperBound) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_analysis.depth = m_info.depth;
+                m_analysis.mate = m_info.mate;
+                m_analysis.score = m_info.score;
+                m_analysis.pv = m_info.pv;
+            }
+            if (m_infoCallback) {
+                m_infoCallback(m_info);
+            }
+        });
+        m_engine->set_on_bestmove([this](std::string_view bestMove, std::string_view ponder) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_analysis.bestMove = std::string(bestMove);
+            m_analysis.ponderMove = std::string(ponder);
+            m_searching = false;
+            m_searchDone.notify_all();
+        });
+        std::cout << "Stockfish engine started in-process" << std::endl;
+    }
+
+    ~InProcessStockfish() {
+        m_engine->stop();
+        m_engine->wait_for_search_finished();
+    }
+
+    InProcessStockfish(const InProcessStockfish&) = delete;
+    InProcessStockfish& operator=(const InProcessStockfish&) = delete;
+
+    // Forget everything learned in the previous game (what ucinewgame does)
+    void newGame() {
+        stopPondering();
+        m_engine->search_clear();
+    }
+
+    std::string getBestMoveTimed(const std::string &fen, int analysisTimeMs = 1000) {
+        Stockfish::Search::LimitsType limits;
+        limits.movetime = analysisTimeMs;
+        return search(fen, limits).bestMove;
+    }
+
+    // Best move in the game made of `moves` (UCI notation) played from rootFen; the engine sees
+    // the whole game, so repetitions count and its search state carries over between moves
+    std::string getBestMoveTimed(const std::string &rootFen, const std::vector<std::string> &moves, int analysisTimeMs = 1000) {
+        Stockfish::Search::LimitsType limits;
+        limits.movetime = analysisTimeMs;
+        return search(rootFen, limits, moves).bestMove;
+    }
+
+    // Search the game made of `moves` played from rootFen and report the score and PV as well
+    Analysis analyze(const std::string &rootFen, const std::vector<std::string> &moves, const SearchLimits &searchLimits) {
+        Stockfish::Search::LimitsType limits = toLimitsType(searchLimits);
+        return search(rootFen, limits, moves);
+    }
+
+    // The reply the engine expects to the move it last suggested ("" if it gave none)
+    std::string ponderMove() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_analysis.ponderMove;
+    }
+
+    // Think on the opponent's time: search the game as if `predictedMove` had been played,
+    // without waiting for the result. Follow up with ponderHit if the opponent did play it,
+    // otherwise stopPondering. analysisTimeMs counts from now, so a hit after that long
+    // answers at once.
+    void startPondering(const std::string &rootFen, const std::vector<std::string> &moves,
+                        const std::string &predictedMove, int analysisTimeMs = 1000) {
+        startPondering(rootFen, moves, predictedMove, SearchLimits::forTime(analysisTimeMs));
+    }
+
+    // The same, for a game on a clock: `limits` holds the clocks as they will stand when the
+    // predicted move has been played
+    void startPondering(const std::string &rootFen, const std::vector<std::string> &moves,
+                        const std::string &predictedMove, const SearchLimits &searchLimits) {
+        stopPondering();
+        m_engine->get_options()["Ponder"] = std::string("true");
+        std::vector<std::string> expected = moves;
+        expected.push_back(predictedMove);
+        m_engine->set_position(rootFen, expected);
+
+        Stockfish::Search::LimitsType limits = toLimitsType(searchLimits);
+        limits.ponderMode = true;
+        start(limits);
+        m_pondering = true;
+    }
+
+    bool isPondering() const {
+        return m_pondering;
+    }
+
+    // The opponent played the predicted move: finish the ponder search and return its result
+    Analysis ponderHit() {
+        if (!m_pondering) {
+            return Analysis();
+        }
+        m_pondering = false;
+        m_engine->set_ponderhit(false);
+        return wait();
+    }
+
+    // The opponent played something else: abandon the ponder search
+    void stopPondering() {
+        if (m_pondering) {
+            m_pondering = false;
+            m_engine->stop();
+            wait();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_analysis.ponderMove.clear();
+        }
+    }
+
+    std::string getBestMoveAtDepth(const std::string &fen, int depth) {
+        Stockfish::Search::LimitsType limits;
+        limits.depth = depth;
+        return search(fen, limits).bestMove;
+    }
+
+    std::pair<std::string, int> getBestMoveWithDepth(const std::string &fen, int analysisTimeMs = 1000) {
+        Stockfish::Search::LimitsType limits;
+        limits.movetime = analysisTimeMs;
+        Analysis analysis = search(fen, limits);
+        return std::make_pair(analysis.bestMove, analysis.depth);
+    }
+
+    // Called with every info update while the engine searches, on the engine's search thread.
+    // Set it while no search is running.
+    void setInfoCallback(UciParser::InfoCallback callback) {
+        m_infoCallback = std::move(callback);
+    }
+
+    // Nothing is logged per search; kept for the same interface as StockfishWrapper
+    void setLogging(bool) {}
+
+    // Direct access for options and anything the helpers above don't cover
+    Stockfish::Engine &engine() {
+        return *m_engine;
+    }
+
+private:
+    std::unique_ptr<Stockfish::Engine> m_engine;
+    std::mutex m_mutex;
+    std::condition_variable m_searchDone;
+    bool m_searching = false;
+    Analysis m_analysis;        // of the running or last search
+    UciInfo m_info;             // the latest info update, reused for the next
+    UciParser::InfoCallback m_infoCallback;
+    bool m_pondering = false;   // a ponder search is running; only touched by the caller's thread
+
+    // Stockfish's global tables, built once per process (its main() normally does this)
+    static void initTables() {
+        static const bool initialized = [] {
+            Stockfish::Bitboards::init();
+            Stockfish::Position::init();
+            return true;
+        }();
+        (void)initialized;
+    }
+
+    static Stockfish::Search::LimitsType toLimitsType(const SearchLimits &requested) {
+        // empty limits search for the default time rather than until stopped
+        const SearchLimits searchLimits = requested.bounded();
+        Stockfish::Search::LimitsType limits;
+        limits.depth = searchLimits.depth;
+        limits.movetime = searchLimits.movetimeMs;
+        limits.nodes = static_cast<uint64_t>(searchLimits.nodes);
+        limits.time[Stockfish::WHITE] = searchLimits.whiteTimeMs;
+        limits.time[Stockfish::BLACK] = searchLimits.blackTimeMs;
+        limits.inc[Stockfish::WHITE] = searchLimits.whiteIncMs;
+        limits.inc[Stockfish::BLACK] = searchLimits.blackIncMs;
+        limits.movestogo = searchLimits.movesToGo;
+        return limits;
+    }
+
+    // Run one search to completion
+    Analysis search(const std::string &fen, Stockfish::Search::LimitsType &limits,
+                                       const std::vector<std::string> &moves = {}) {
+        stopPondering();
+        m_engine->wait_for_search_finished();
+        m_engine->set_position(fen, moves);
+        start(limits);
+        return wait();
+    }
+
+    // Start a search on the position already set
+    void start(Stockfish::Search::LimitsType &limits) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_analysis = Analysis();
+            m_searching = true;
+        }
+        limits.startTime = Stockfish::now();
+        m_engine->go(limits);
+    }
+
+    // Wait for the running search's bestmove
+    Analysis wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_searchDone.wait(lock, [this] { return !m_searching; });
+        return m_analysis;
+    }
+
+    // The update as the UCI info line Stockfish would have printed for it
+    static void toUciInfo(const Stockfish::Engine::InfoFull &full, UciInfo &info) {
+        info.clear();
+        info.depth = full.depth;
+        info.selDepth = full.selDepth;
+        info.multiPv = static_cast<int>(full.multiPV);
+        info.hasScore = true;
+        // mate in moves, otherwise centipawns (tablebase wins near 20000)
+        info.mate = full.score.is<Stockfish::Score::Mate>();
+        if (info.mate) {
+            int plies = full.score.get<Stockfish::Score::Mate>().plies;
+            info.score = (plies > 0 ? plies + 1 : plies) / 2;
+        } else if (full.score.is<Stockfish::Score::Tablebase>()) {
+            Stockfish::Score::Tablebase tb = full.score.get<Stockfish::Score::Tablebase>();
+            info.score = tb.win ? 20000 - tb.plies : -20000 - tb.plies;
+        } else {
+            info.score = full.score.get<Stockfish::Score::InternalUnits>().value;
+        }
+        info.lowerBound = full.bound == "lowerbound";
+        info.upperBound = full.bound == "upperbound";
+        info.timeMs = static_cast<int>(full.timeMs);
+        info.nodes = full.nodes;
+        info.nps = full.nps;
+        info.tbHits = full.tbHits;
+        info.hashFull = full.hashfull;
+        for (size_t start = 0; start < full.pv.size(); ) {
+            size_t end = std::min(full.pv.find(' ', start), full.pv.size());
+            if (end > start) {
+                info.pv.emplace_back(full.pv.substr(start, end - start));
+            }
+            start = end + 1;
+        }
+    }
+};
+
+#endif // INPROCESSSTOCKFISH_H
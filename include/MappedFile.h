@@ -0,0 +1,46 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// A whole file mapped into memory. Read-only mappings share the page cache with every other
+// process reading the file; writable ones write straight through to it.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Map an existing file for reading. False (and nothing mapped) if that fails.
+    bool openReadOnly(const std::string& path);
+
+    // Map a file for reading and writing, creating it or growing it to `size` bytes first
+    // (new bytes read as zero)
+    bool openReadWrite(const std::string& path, size_t size);
+
+    // Unmap, flushing written pages to the file
+    void close();
+
+    // Push written pages to disk now rather than whenever the system gets to them
+    void flush();
+
+    bool isOpen() const {
+        return mapping != nullptr;
+    }
+    unsigned char* data() const {
+        return static_cast<unsigned char*>(mapping);
+    }
+    size_t size() const {
+        return length;
+    }
+
+private:
+    void* mapping = nullptr;
+    size_t length = 0;
+    bool writable = false;
+};
+
+#endif // MAPPEDFILE_H
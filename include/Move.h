@@ -17,13 +17,16 @@ private:
     bool isCastling;
     bool isPromotion;
     std::shared_ptr<Piece> promotionPiece;
+    PieceType promotionType;
 
 public:
     // Constructors
     Move(Position from, Position to, std::shared_ptr<Piece> movedPiece, std::shared_ptr<Piece> capturedPiece = nullptr,
-         bool isCastling = false, bool isPromotion = false, std::shared_ptr<Piece> promotionPiece = nullptr)
+         bool isCastling = false, bool isPromotion = false, std::shared_ptr<Piece> promotionPiece = nullptr,
+         PieceType promotionType = PieceType::QUEEN)
         : from(from), to(to), movedPiece(movedPiece), capturedPiece(capturedPiece),
-        isCastling(isCastling), isPromotion(isPromotion), promotionPiece(promotionPiece) {}
+        isCastling(isCastling), isPromotion(isPromotion), promotionPiece(promotionPiece),
+        promotionType(promotionType) {}
 
     // Accessors
     Position getFrom() const { return from; }
@@ -33,11 +36,12 @@ public:
     bool getIsCastling() const { return isCastling; }
     bool getIsPromotion() const { return isPromotion; }
     std::shared_ptr<Piece> getPromotionPiece() const { return promotionPiece; }
+    PieceType getPromotionType() const { return promotionType; }
 
     // Execute the move on the board
     void execute(Board& board);
 
-    // Undo the move on the board
+    // Undo the move on the board. Must be the last move played.
     void undo(Board& board);
 };
 
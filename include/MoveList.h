@@ -0,0 +1,75 @@
+#ifndef MOVELIST_H
+#define MOVELIST_H
+
+#include <cstdint>
+#include <string>
+#include "Piece.h"
+
+// A move packed into 16 bits:
+//   bits  0-5   origin square
+//   bits  6-11  destination square
+//   bits 12-13  promotion piece type (ROOK, KNIGHT, BISHOP or QUEEN)
+//   bits 14-15  flag
+class PackedMove {
+public:
+    enum Flag : uint16_t { NORMAL = 0, PROMOTION = 1, EN_PASSANT = 2, CASTLING = 3 };
+
+    PackedMove() : data(0) {}
+    PackedMove(int from, int to, Flag flag = NORMAL, PieceType promotionType = PieceType::QUEEN)
+        : data(static_cast<uint16_t>(from | (to << 6) | ((static_cast<int>(promotionType) & 3) << 12) | (flag << 14))) {}
+
+    int getFrom() const { return data & 0x3F; }
+    int getTo() const { return (data >> 6) & 0x3F; }
+    Flag getFlag() const { return static_cast<Flag>(data >> 14); }
+    PieceType getPromotionType() const { return static_cast<PieceType>((data >> 12) & 3); }
+    uint16_t raw() const { return data; }
+
+    // Long algebraic notation as used by UCI, e.g. "e2e4" or "e7e8q"
+    std::string toUci() const {
+        std::string uci;
+        uci += static_cast<char>('a' + getFrom() % 8);
+        uci += static_cast<char>('1' + getFrom() / 8);
+        uci += static_cast<char>('a' + getTo() % 8);
+        uci += static_cast<char>('1' + getTo() / 8);
+        if (getFlag() == PROMOTION) {
+            uci += "rnbq"[static_cast<int>(getPromotionType())];
+        }
+        return uci;
+    }
+
+    bool operator==(const PackedMove& other) const { return data == other.data; }
+    bool operator!=(const PackedMove& other) const { return data != other.data; }
+
+private:
+    uint16_t data;
+};
+
+// Fixed-capacity move buffer that lives on the stack; no position has more than 218 legal moves
+class MoveList {
+public:
+    static constexpr int Capacity = 256;
+
+    void push(PackedMove move) { moves[count++] = move; }
+    void clear() { count = 0; }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    const PackedMove& operator[](int i) const { return moves[i]; }
+    const PackedMove* begin() const { return moves; }
+    const PackedMove* end() const { return moves + count; }
+
+    bool contains(PackedMove move) const {
+        for (int i = 0; i < count; ++i) {
+            if (moves[i] == move) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    PackedMove moves[Capacity];
+    int count = 0;
+};
+
+#endif // MOVELIST_H
@@ -2,10 +2,12 @@
 #define PIECE_H
 
 #include <vector>
+#include <cstdint>
 #include <cmath>
 #include <algorithm>
 #include <iostream>
 #include "Position.h"
+#include "Bitboard.h"
 #include <string>
 
 class Board;
@@ -15,7 +17,17 @@ enum class PieceType { ROOK, KNIGHT, BISHOP, QUEEN, KING, PAWN, EMPTY };
 enum class Color { WHITE, BLACK };
 std::ostream& operator<<(std::ostream& os, Color color);
 
-enum class pieceTypeWithColor { wr, wn, wb, wq, wk, wp, br, bn, bb, bq, bk, bp, empty };
+enum class pieceTypeWithColor : uint8_t { wr, wn, wb, wq, wk, wp, br, bn, bb, bq, bk, bp, empty };
+
+inline pieceTypeWithColor makePiece(PieceType type, Color color) {
+    return static_cast<pieceTypeWithColor>(static_cast<int>(type) + 6 * static_cast<int>(color));
+}
+inline PieceType typeOf(pieceTypeWithColor piece) {
+    return static_cast<PieceType>(static_cast<int>(piece) % 6);
+}
+inline Color colorOf(pieceTypeWithColor piece) {
+    return static_cast<Color>(static_cast<int>(piece) / 6);
+}
 
 class Piece {
 protected:
@@ -25,15 +37,10 @@ protected:
 
 public:
     // Constructor
-    Piece(PieceType type, Color color, Position pos) : type(type), color(color), position(pos)
-    {
-        moves.reserve(64);
-    }
+    Piece(PieceType type, Color color, Position pos) : type(type), color(color), position(pos) {}
 
-    pieceTypeWithColor getPieceTypeWithColor() {
-        int pieceType = static_cast<int>(type);
-        int pieceColor = static_cast<int>(color);
-        return static_cast<pieceTypeWithColor>(pieceType + 6 * pieceColor);
+    pieceTypeWithColor getPieceTypeWithColor() const {
+        return makePiece(type, color);
     }
     
     bool hasMoved = false;
@@ -59,11 +66,12 @@ public:
         position = pos;
     }
 
-    virtual bool isCastling(Position to) {
+    virtual bool isCastling(Position to) const {
         return false;
     }
 
-    std::vector<Position> filterCheckMoves(const Board& board, std::vector<Position>& moves);
+    // The subset of `moves` that doesn't leave the own king in check
+    std::vector<Position> filterCheckMoves(const Board& board, const std::vector<Position>& moves) const;
 
     // Check if a move is valid
     virtual bool isValidMove(const Board& board, Position from, Position to) const = 0;
@@ -73,8 +81,13 @@ public:
 
     virtual std::string getPieceType() const = 0;
 
-    // Generate all possible moves for the piece
-    virtual std::vector<Position>& generatePossibleMoves(const Board& board) = 0;
+    // Append the legal destinations of this piece to `out`. Only reads the board, so any number
+    // of threads may call it at once, on the same position or different ones.
+    void generateMoves(const Board& board, std::vector<Position>& out) const;
+
+    // Generate all possible moves for the piece. Same as generateMoves, but kept in `moves`,
+    // so concurrent calls on the same piece are not safe.
+    std::vector<Position>& generatePossibleMoves(const Board& board);
 
     // Get FEN character for the piece
     char getFENChar() const {
@@ -110,11 +123,7 @@ public:
 
     std::string getPieceType() const override;
 
-    bool isCastling(Position to) override;
-
-    std::vector<Position>& generatePossibleMoves(const Board& board) override;
-
-    std::vector<Position> castlingMoves;
+    bool isCastling(Position to) const override;
 };
 
 class Queen : public Piece {
@@ -125,8 +134,6 @@ public:
 
     char getSymbol() const override;
     std::string getPieceType() const override;
-
-    std::vector<Position>& generatePossibleMoves(const Board& board) override;
 };
 
 class Bishop : public Piece {
@@ -137,8 +144,6 @@ public:
 
     char getSymbol() const override;
     std::string getPieceType() const override;
-
-    std::vector<Position>& generatePossibleMoves(const Board& board) override;
 };
 
 class Knight : public Piece {
@@ -149,8 +154,6 @@ public:
 
     char getSymbol() const override;
     std::string getPieceType() const override;
-
-    std::vector<Position>& generatePossibleMoves(const Board& board) override;
 };
 
 class Rook : public Piece {
@@ -161,8 +164,6 @@ public:
 
     char getSymbol() const override;
     std::string getPieceType() const override;
-
-    std::vector<Position>& generatePossibleMoves(const Board& board) override;
 };
 
 class Pawn : public Piece {
@@ -173,8 +174,6 @@ public:
 
     char getSymbol() const override;
     std::string getPieceType() const override;
-
-    std::vector<Position>& generatePossibleMoves(const Board& board) override;
 };
 
 #endif // PIECE_H
@@ -0,0 +1,98 @@
+#ifndef PIECEARENA_H
+#define PIECEARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include "Piece.h"
+
+// Storage for the Piece objects behind Board's pointer-based accessors. Pieces are made with
+// allocate_shared, so the shared_ptrs handed out own their piece like any other: a piece a
+// caller still holds outlives its capture. The blocks (piece and control block together) are
+// recycled through a per-thread free list instead of going back to the heap, so once a
+// thread has set up a few boards, setting up or copying another doesn't allocate.
+class PieceArena {
+public:
+    // Construct a piece; never null (throws std::bad_alloc like make_shared)
+    static std::shared_ptr<Piece> create(PieceType type, Color color, Position pos);
+
+private:
+    // Room for the largest piece with its control block; anything bigger uses the heap
+    static constexpr size_t BlockSize = 128;
+    // Free blocks a thread keeps before handing further ones back to the heap
+    static constexpr size_t MaxFreeBlocks = 1024;
+
+    static void* allocateBlock(size_t bytes);
+    static void freeBlock(void* block, size_t bytes);
+
+    template <typename T>
+    struct Allocator {
+        using value_type = T;
+
+        Allocator() = default;
+        template <typename U>
+        Allocator(const Allocator<U>&) {}
+
+        T* allocate(size_t n) {
+            return static_cast<T*>(allocateBlock(n * sizeof(T)));
+        }
+        void deallocate(T* block, size_t n) {
+            freeBlock(block, n * sizeof(T));
+        }
+
+        template <typename U>
+        bool operator==(const Allocator<U>&) const { return true; }
+        template <typename U>
+        bool operator!=(const Allocator<U>&) const { return false; }
+    };
+
+    template <typename T>
+    static std::shared_ptr<Piece> make(Color color, Position pos) {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "pool blocks are max_align_t aligned");
+        return std::allocate_shared<T>(Allocator<T>(), color, pos);
+    }
+};
+
+// The pieces of one color. Fixed capacity so it never allocates; removal swaps in the last
+// entry instead of shifting the rest.
+class PieceList {
+public:
+    static constexpr int Capacity = 16;
+
+    // Throws std::length_error if the list already holds Capacity pieces
+    void push_back(const std::shared_ptr<Piece>& piece) {
+        if (count == Capacity) {
+            throw std::length_error("more than 16 pieces of one color");
+        }
+        pieces[count++] = piece;
+    }
+
+    void remove(const std::shared_ptr<Piece>& piece) {
+        for (int i = 0; i < count; ++i) {
+            if (pieces[i] == piece) {
+                pieces[i] = pieces[--count];
+                pieces[count] = nullptr;
+                return;
+            }
+        }
+    }
+
+    void clear() {
+        for (int i = 0; i < count; ++i) {
+            pieces[i] = nullptr;
+        }
+        count = 0;
+    }
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    const std::shared_ptr<Piece>& operator[](int i) const { return pieces[i]; }
+    const std::shared_ptr<Piece>* begin() const { return pieces; }
+    const std::shared_ptr<Piece>* end() const { return pieces + count; }
+
+private:
+    std::shared_ptr<Piece> pieces[Capacity];
+    int count = 0;
+};
+
+#endif // PIECEARENA_H
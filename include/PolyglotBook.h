@@ -0,0 +1,69 @@
+#ifndef POLYGLOTBOOK_H
+#define POLYGLOTBOOK_H
+
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+#include "Board.h"
+#include "MappedFile.h"
+
+// An opening book in the Polyglot .bin format, memory-mapped and probed in place: the file
+// is a sorted array of 16-byte big-endian entries (key, move, weight, learn), so a probe is
+// a binary search on the position's Polyglot key.
+//
+// Safe to share between threads.
+class PolyglotBook {
+public:
+    // How probe picks among the position's book moves
+    enum class Selection {
+        WEIGHTED,   // at random, in proportion to the weights
+        BEST        // always the highest weight
+    };
+
+    struct BookMove {
+        std::string move;   // UCI notation
+        uint16_t weight;
+    };
+
+    PolyglotBook() = default;
+    // Open `path` now; check isOpen() for the outcome
+    explicit PolyglotBook(const std::string& path);
+
+    PolyglotBook(const PolyglotBook&) = delete;
+    PolyglotBook& operator=(const PolyglotBook&) = delete;
+
+    // Map a book file. False (and no book) if it can't be read or isn't a Polyglot book.
+    bool open(const std::string& path);
+
+    bool isOpen() const {
+        return file.isOpen();
+    }
+    // Number of entries in the book
+    size_t size() const {
+        return count;
+    }
+
+    // The book's legal moves for the position, in file order (highest weight first in
+    // books written by polyglot)
+    std::vector<BookMove> moves(const Board& board) const;
+
+    // A book move for the position, or "" if the book has none. Moves with weight 0 are
+    // never picked.
+    std::string probe(const Board& board, Selection selection = Selection::WEIGHTED);
+
+private:
+    static constexpr size_t ENTRY_SIZE = 16;
+
+    uint64_t keyAt(size_t index) const;
+    // Polyglot's move encoding to UCI notation; castling is stored as king takes rook
+    static std::string decodeMove(const Board& board, uint16_t move);
+
+    MappedFile file;
+    size_t count = 0;
+    std::mt19937_64 rng{ std::random_device{}() };
+    std::mutex rngMutex;
+};
+
+#endif // POLYGLOTBOOK_H
@@ -21,6 +21,11 @@ public:
         }
     }
 
+    // Square index (row * 8 + col), the inverse of Position(int)
+    int index() const {
+        return row * 8 + col;
+    }
+
     // Comparison operators
     bool operator==(const Position& other) const {
         return row == other.row && col == other.col;
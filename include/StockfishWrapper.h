@@ -1,16 +1,33 @@
+#ifndef STOCKFISHWRAPPER_H
+#define STOCKFISHWRAPPER_H
+
 #include <iostream>
 #include <string>
 #include <vector>
-#include <windows.h>
 #include <stdexcept>
 #include <chrono>
 #include <algorithm>
+#include "Analysis.h"
+#include "UciParser.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 class StockfishWrapper {
 public:
     StockfishWrapper(const std::string &path) : m_path(path) {
         std::cout << "Starting Stockfish process at: " << path << std::endl;
 
+#ifdef _WIN32
         SECURITY_ATTRIBUTES saAttr;
         saAttr.nLength = sizeof(SECURITY_ATTRIBUTES);
         saAttr.bInheritHandle = TRUE;
@@ -45,6 +62,10 @@ public:
             &m_piProcInfo)) {
             throw std::runtime_error("Failed to start Stockfish. Error code: " + std::to_string(GetLastError()));
         }
+#else
+        startProcess();
+        try {
+#endif
 
         std::cout << "Stockfish process started successfully" << std::endl;
         std::cout << "Sending UCI command..." << std::endl;
@@ -53,9 +74,19 @@ public:
 
         // Ensure the engine is ready
         sendCommand("isready", "readyok", 5000);
+        calibrateMoveOverhead();
+
+#ifndef _WIN32
+        } catch (...) {
+            // the destructor won't run for a half-built wrapper, so reap the engine here
+            stopProcess();
+            throw;
+        }
+#endif
     }
 
     ~StockfishWrapper() {
+#ifdef _WIN32
         if (m_piProcInfo.hProcess != NULL) {
             TerminateProcess(m_piProcInfo.hProcess, 0);
             CloseHandle(m_piProcInfo.hProcess);
@@ -65,41 +96,249 @@ public:
         CloseHandle(m_hChildStdinWrite);
         CloseHandle(m_hChildStdoutRead);
         CloseHandle(m_hChildStdoutWrite);
+#else
+        stopProcess();
+#endif
     }
 
+    StockfishWrapper(const StockfishWrapper&) = delete;
+    StockfishWrapper& operator=(const StockfishWrapper&) = delete;
+
+    // Send a command and wait for the line starting with expectedResponse, which is returned.
+    // With no expected response, whatever output is already there is consumed and "" returned.
     std::string sendCommand(const std::string &command, const std::string &expectedResponse = "", int timeoutMs = 1000) {
-        DWORD bytesWritten;
         std::string cmd = command + "\n";
-        std::cout << "Sending command: " << cmd;
+        if (m_logging) {
+            std::cout << "Sending command: " << cmd;
+        }
+#ifdef _WIN32
+        DWORD bytesWritten;
         if (!WriteFile(m_hChildStdinWrite, cmd.c_str(), cmd.length(), &bytesWritten, NULL)) {
             throw std::runtime_error("Failed to write to pipe");
         }
-        std::cout << "Command sent. Reading output..." << std::endl;
+#else
+        writeAll(cmd);
+#endif
+        if (m_logging) {
+            std::cout << "Command sent. Reading output..." << std::endl;
+        }
         return readOutput(expectedResponse, timeoutMs);
     }
 
+    // Tell the engine the next search belongs to a different game, and wait until it has reset
+    void newGame() {
+        stopPondering();
+        sendCommand("ucinewgame");
+        sendCommand("isready", "readyok", 5000);
+    }
+
     std::string getBestMoveTimed(const std::string &fen, int analysisTimeMs = 1000) {
+        stopPondering();
         sendCommand("position fen " + fen);
-        std::string output = sendCommand("go movetime " + std::to_string(analysisTimeMs), "bestmove", analysisTimeMs + 500);
-        return parseBestMove(output);
+        return runSearch("go movetime " + std::to_string(analysisTimeMs), analysisTimeMs + 500).bestMove;
+    }
+
+    // Best move in the game made of `moves` (UCI notation) played from rootFen. The engine gets
+    // the real game history rather than a bare FEN, so repetitions count and its search state
+    // carries over from move to move; while the game only grows, each call just appends the
+    // new moves to the position command.
+    std::string getBestMoveTimed(const std::string &rootFen, const std::vector<std::string> &moves, int analysisTimeMs = 1000) {
+        return analyze(rootFen, moves, SearchLimits::forTime(analysisTimeMs)).bestMove;
+    }
+
+    // Search the game made of `moves` played from rootFen and report the score and PV as well
+    Analysis analyze(const std::string &rootFen, const std::vector<std::string> &moves, const SearchLimits &limits) {
+        stopPondering();
+        sendCommand(positionCommand(rootFen, moves));
+        Analysis analysis = runSearch("go" + limits.goArguments(), timeoutFor(limits));
+        if (limits.usesClock()) {
+            // the engine just spent the time it was given, which is when a late reply costs the game
+            sampleMoveOverhead();
+        }
+        return analysis;
+    }
+
+    // Milliseconds the engine keeps in hand on every move for its bestmove to reach us
+    // through the pipe (Stockfish's "Move Overhead"). Measured rather than guessed: set from
+    // the slowest isready round trip seen at startup and after every search on a clock.
+    int moveOverheadMs() const {
+        return m_moveOverheadMs;
+    }
+
+    // The reply the engine expects to the move it last suggested ("" if it gave none)
+    const std::string &ponderMove() const {
+        return m_ponderMove;
+    }
+
+    // Think on the opponent's time: search the game as if `predictedMove` had been played,
+    // without waiting for the result. Follow up with ponderHit if the opponent did play it,
+    // otherwise stopPondering. analysisTimeMs counts from now, so a hit after that long
+    // answers at once.
+    void startPondering(const std::string &rootFen, const std::vector<std::string> &moves,
+                        const std::string &predictedMove, int analysisTimeMs = 1000) {
+        startPondering(rootFen, moves, predictedMove, SearchLimits::forTime(analysisTimeMs));
+    }
+
+    // The same, for a game on a clock: `limits` holds the clocks as they will stand when the
+    // predicted move has been played
+    void startPondering(const std::string &rootFen, const std::vector<std::string> &moves,
+                        const std::string &predictedMove, const SearchLimits &limits) {
+        stopPondering();
+        if (!m_ponderOption) {
+            // tells the engine it will be allowed to think on the opponent's time
+            sendCommand("setoption name Ponder value true");
+            m_ponderOption = true;
+        }
+        std::vector<std::string> expected = moves;
+        expected.push_back(predictedMove);
+        sendCommand(positionCommand(rootFen, expected));
+        m_parser.startSearch();
+        sendCommand("go ponder" + limits.goArguments());
+        m_pondering = true;
+        m_ponderTimeoutMs = timeoutFor(limits);
+    }
+
+    bool isPondering() const {
+        return m_pondering;
+    }
+
+    // The opponent played the predicted move: finish the ponder search and return its result
+    Analysis ponderHit() {
+        if (!m_pondering) {
+            return Analysis();
+        }
+        m_pondering = false;
+        sendCommand("ponderhit", "bestmove", m_ponderTimeoutMs);
+        return finishSearch();
+    }
+
+    // The opponent played something else: abandon the ponder search
+    void stopPondering() {
+        if (m_pondering) {
+            m_pondering = false;
+            sendCommand("stop", "bestmove", 5000);
+            m_ponderMove.clear();
+        }
     }
 
     std::string getBestMoveAtDepth(const std::string &fen, int depth) {
+        stopPondering();
         sendCommand("position fen " + fen);
-        std::string output = sendCommand("go depth " + std::to_string(depth), "bestmove", 1000);
-        return parseBestMove(output);
+        return runSearch("go depth " + std::to_string(depth), 1000).bestMove;
     }
 
     std::pair<std::string, int> getBestMoveWithDepth(const std::string &fen, int analysisTimeMs = 1000) {
+        stopPondering();
         sendCommand("position fen " + fen);
-        std::string output = sendCommand("go movetime " + std::to_string(analysisTimeMs), "bestmove", analysisTimeMs + 500);
-        int maxDepth = parseMaxDepth(output);
-        std::string bestMove = parseBestMove(output);
-        return std::make_pair(bestMove, maxDepth);
+        Analysis analysis = runSearch("go movetime " + std::to_string(analysisTimeMs), analysisTimeMs + 500);
+        return std::make_pair(analysis.bestMove, analysis.depth);
+    }
+
+    // Echo every command and reply to stdout (on by default)
+    void setLogging(bool enabled) {
+        m_logging = enabled;
+    }
+
+    // Called with every info line while the engine searches, on the thread talking to the
+    // engine, as the lines are read
+    void setInfoCallback(UciParser::InfoCallback callback) {
+        m_parser.setInfoCallback(std::move(callback));
     }
 
 private:
     std::string m_path;
+    UciParser m_parser;
+    bool m_logging = true;
+    std::string m_rootFen;              // game last sent with positionCommand
+    std::vector<std::string> m_moves;
+    std::string m_positionCommand;
+    std::string m_ponderMove;           // from the last bestmove
+    bool m_ponderOption = false;        // "Ponder" option sent
+    bool m_pondering = false;           // "go ponder" sent, bestmove not read yet
+    int m_ponderTimeoutMs = 0;
+    int m_moveOverheadMs = 0;           // last value sent for "Move Overhead"
+
+    // How long a search without a time limit may take before the engine is given up on
+    static constexpr int SEARCH_TIMEOUT_MS = 10 * 60 * 1000;
+    // "Move Overhead" bounds: Stockfish's default and the option's maximum
+    static constexpr int MIN_MOVE_OVERHEAD_MS = 10;
+    static constexpr int MAX_MOVE_OVERHEAD_MS = 5000;
+    // isready round trips timed at startup
+    static constexpr int OVERHEAD_SAMPLES = 8;
+
+    static int timeoutFor(const SearchLimits &searchLimits) {
+        const SearchLimits limits = searchLimits.bounded();
+        if (limits.movetimeMs > 0) {
+            return limits.movetimeMs + 500;
+        }
+        if (limits.usesClock()) {
+            // the engine never plans to use more than its whole clock
+            long long clock = std::max(limits.whiteTimeMs, limits.blackTimeMs) + std::max(limits.whiteIncMs, limits.blackIncMs);
+            return static_cast<int>(std::min<long long>(clock + 1000, SEARCH_TIMEOUT_MS));
+        }
+        return SEARCH_TIMEOUT_MS;
+    }
+
+    // Milliseconds (rounded up) for an isready to go through the pipe and readyok to come back
+    long long roundTripMs() {
+        auto start = std::chrono::steady_clock::now();
+        sendCommand("isready", "readyok", 5000);
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        return (elapsed.count() + 999) / 1000;
+    }
+
+    void calibrateMoveOverhead() {
+        long long slowest = 0;
+        for (int i = 0; i < OVERHEAD_SAMPLES; ++i) {
+            slowest = std::max(slowest, roundTripMs());
+        }
+        raiseMoveOverhead(slowest);
+    }
+
+    void sampleMoveOverhead() {
+        raiseMoveOverhead(roundTripMs());
+    }
+
+    // Allow for twice a measured round trip: the bestmove travels one way, but the engine may
+    // be descheduled on either side of it. The overhead only ever grows, so one slow reply
+    // keeps every later move safe.
+    void raiseMoveOverhead(long long roundTripMs) {
+        int overhead = static_cast<int>(std::clamp<long long>(2 * roundTripMs, MIN_MOVE_OVERHEAD_MS, MAX_MOVE_OVERHEAD_MS));
+        if (overhead > m_moveOverheadMs) {
+            m_moveOverheadMs = overhead;
+            sendCommand("setoption name Move Overhead value " + std::to_string(overhead));
+        }
+    }
+
+    // Send a go command and wait for its bestmove
+    Analysis runSearch(const std::string &goCommand, int timeoutMs) {
+        m_parser.startSearch();
+        sendCommand(goCommand, "bestmove", timeoutMs);
+        return finishSearch();
+    }
+
+    Analysis finishSearch() {
+        m_ponderMove = m_parser.getAnalysis().ponderMove;
+        return m_parser.getAnalysis();
+    }
+
+    const std::string &positionCommand(const std::string &rootFen, const std::vector<std::string> &moves) {
+        bool extendsLastGame = !m_positionCommand.empty() && rootFen == m_rootFen && moves.size() >= m_moves.size()
+                               && std::equal(m_moves.begin(), m_moves.end(), moves.begin());
+        if (!extendsLastGame) {
+            m_rootFen = rootFen;
+            m_moves.clear();
+            m_positionCommand = rootFen == "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+                ? "position startpos moves" : "position fen " + rootFen + " moves";
+        }
+        for (size_t i = m_moves.size(); i < moves.size(); ++i) {
+            m_positionCommand += ' ';
+            m_positionCommand += moves[i];
+            m_moves.push_back(moves[i]);
+        }
+        return m_positionCommand;
+    }
+#ifdef _WIN32
     HANDLE m_hChildStdinRead = NULL;
     HANDLE m_hChildStdinWrite = NULL;
     HANDLE m_hChildStdoutRead = NULL;
@@ -109,9 +348,9 @@ private:
     std::string readOutput(const std::string &expectedResponse, int timeoutMs) {
         DWORD dwRead;
         CHAR chBuf[4096];
-        std::string output;
         BOOL bSuccess = FALSE;
         auto start = std::chrono::steady_clock::now();
+        m_parser.expect(expectedResponse);
 
         while (true) {
             DWORD dwAvail = 0;
@@ -122,55 +361,179 @@ private:
             if (dwAvail > 0) {
                 bSuccess = ReadFile(m_hChildStdoutRead, chBuf, std::min(dwAvail, (DWORD)4096), &dwRead, NULL);
                 if (!bSuccess || dwRead == 0) break;
-                output.append(chBuf, dwRead);
-                if (!expectedResponse.empty() && output.find(expectedResponse) != std::string::npos) {
-                    std::cout << "Expected response received: " << expectedResponse << std::endl;
-                    break;
+                if (m_parser.feed(chBuf, dwRead)) {
+                    if (m_logging) {
+                        std::cout << "Expected response received: " << expectedResponse << std::endl;
+                    }
+                    return m_parser.getMatchedLine();
                 }
+                continue;
             } else if (expectedResponse.empty()) {
                 // If no expected response and no data available, return immediately
-                return output;
+                return "";
             }
 
             auto now = std::chrono::steady_clock::now();
             auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
             if (elapsed > timeoutMs) {
-                std::cout << "Timeout reached. Partial output: " << output << std::endl;
+                std::cout << "Timeout reached waiting for " << expectedResponse << std::endl;
                 throw std::runtime_error("Timeout while reading output");
             }
 
             Sleep(10); // Small delay to prevent busy waiting
         }
-        return output;
-    }
-
-    std::string parseBestMove(const std::string &output) {
-        std::string::size_type pos = output.find("bestmove ");
-        if (pos == std::string::npos) return "";
-        pos += 9; // Length of "bestmove "
-        std::string::size_type end = output.find(' ', pos);
-        return output.substr(pos, end - pos);
-    }
-
-    int parseMaxDepth(const std::string &output) {
-        int maxDepth = 0;
-        std::istringstream iss(output);
-        std::string line;
-        while (std::getline(iss, line)) {
-            if (line.substr(0, 5) == "info ") {
-                std::istringstream lineStream(line);
-                std::string token;
-                while (lineStream >> token) {
-                    if (token == "depth") {
-                        int depth;
-                        if (lineStream >> depth) {
-                            maxDepth = std::max(maxDepth, depth);
-                        }
-                        break;
+        throw std::runtime_error("Failed to read pipe");
+    }
+#else
+    pid_t m_pid = -1;
+    int m_stdin = -1;  // our end of the engine's stdin
+    int m_stdout = -1; // our end of the engine's stdout and stderr
+
+    // How long the engine gets to exit after "quit" before it is killed
+    static constexpr int QUIT_TIMEOUT_MS = 1000;
+
+    void startProcess() {
+        // a dead engine must surface as a write error, not kill us
+        std::signal(SIGPIPE, SIG_IGN);
+
+        int toChild[2], fromChild[2];
+        if (pipe(toChild) != 0) {
+            throw std::runtime_error("Failed to create pipes");
+        }
+        if (pipe(fromChild) != 0) {
+            close(toChild[0]);
+            close(toChild[1]);
+            throw std::runtime_error("Failed to create pipes");
+        }
+        // none of the pipe ends should leak into other processes we start
+        for (int fd : { toChild[0], toChild[1], fromChild[0], fromChild[1] }) {
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+
+        m_pid = fork();
+        if (m_pid < 0) {
+            for (int fd : { toChild[0], toChild[1], fromChild[0], fromChild[1] }) {
+                close(fd);
+            }
+            throw std::runtime_error("Failed to fork: " + std::string(std::strerror(errno)));
+        }
+        if (m_pid == 0) {
+            // child: only async-signal-safe calls until exec
+            dup2(toChild[0], STDIN_FILENO);
+            dup2(fromChild[1], STDOUT_FILENO);
+            dup2(fromChild[1], STDERR_FILENO);
+            execlp(m_path.c_str(), m_path.c_str(), static_cast<char*>(nullptr));
+            _exit(127);
+        }
+
+        close(toChild[0]);
+        close(fromChild[1]);
+        m_stdin = toChild[1];
+        m_stdout = fromChild[0];
+        fcntl(m_stdin, F_SETFL, fcntl(m_stdin, F_GETFL) | O_NONBLOCK);
+        fcntl(m_stdout, F_SETFL, fcntl(m_stdout, F_GETFL) | O_NONBLOCK);
+    }
+
+    // Ask the engine to quit and reap it, killing it if it hasn't exited within the timeout
+    void stopProcess() {
+        if (m_pid > 0) {
+            try {
+                writeAll("quit\n");
+            } catch (const std::exception&) {
+                // already gone; reaped below
+            }
+            // the engine closing its end of the pipe wakes us as soon as it exits
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(QUIT_TIMEOUT_MS);
+            char buffer[4096];
+            bool reaped = false;
+            while (!reaped) {
+                if (waitpid(m_pid, nullptr, WNOHANG) != 0) {
+                    reaped = true;
+                    break;
+                }
+                int remaining = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now()).count());
+                if (remaining <= 0) {
+                    break;
+                }
+                pollfd pfd{ m_stdout, POLLIN, 0 };
+                if (poll(&pfd, 1, remaining) > 0 && read(m_stdout, buffer, sizeof(buffer)) == 0) {
+                    // end of file: the engine is on its way out
+                    reaped = waitpid(m_pid, nullptr, 0) != 0;
+                }
+            }
+            if (!reaped) {
+                kill(m_pid, SIGKILL);
+                waitpid(m_pid, nullptr, 0);
+            }
+            m_pid = -1;
+        }
+        if (m_stdin >= 0) {
+            close(m_stdin);
+            m_stdin = -1;
+        }
+        if (m_stdout >= 0) {
+            close(m_stdout);
+            m_stdout = -1;
+        }
+    }
+
+    void writeAll(const std::string &data) {
+        size_t written = 0;
+        while (written < data.size()) {
+            ssize_t n = write(m_stdin, data.data() + written, data.size() - written);
+            if (n > 0) {
+                written += static_cast<size_t>(n);
+            } else if (n < 0 && errno == EAGAIN) {
+                pollfd pfd{ m_stdin, POLLOUT, 0 };
+                poll(&pfd, 1, -1);
+            } else if (n < 0 && errno != EINTR) {
+                throw std::runtime_error("Failed to write to pipe");
+            }
+        }
+    }
+
+    // Block in poll until the engine writes, so a reply is consumed the moment it arrives
+    std::string readOutput(const std::string &expectedResponse, int timeoutMs) {
+        char buffer[4096];
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        m_parser.expect(expectedResponse);
+
+        while (true) {
+            ssize_t n = read(m_stdout, buffer, sizeof(buffer));
+            if (n > 0) {
+                if (m_parser.feed(buffer, static_cast<size_t>(n))) {
+                    if (m_logging) {
+                        std::cout << "Expected response received: " << expectedResponse << std::endl;
                     }
+                    return m_parser.getMatchedLine();
                 }
+                continue;
+            }
+            if (n == 0) {
+                throw std::runtime_error("Stockfish exited while waiting for " + expectedResponse);
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN) {
+                throw std::runtime_error("Failed to read pipe");
+            }
+            if (expectedResponse.empty()) {
+                // If no expected response and no data available, return immediately
+                return "";
+            }
+
+            int remaining = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count());
+            pollfd pfd{ m_stdout, POLLIN, 0 };
+            if (remaining <= 0 || (poll(&pfd, 1, remaining) == 0)) {
+                std::cout << "Timeout reached waiting for " << expectedResponse << std::endl;
+                throw std::runtime_error("Timeout while reading output");
             }
         }
-        return maxDepth;
     }
-};
\ No newline at end of file
+#endif
+};
+
+#endif // STOCKFISHWRAPPER_H
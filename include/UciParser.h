@@ -0,0 +1,203 @@
+#ifndef UCIPARSER_H
+#define UCIPARSER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Analysis.h"
+
+// One "info" line from the engine. Fields the line didn't carry keep their defaults.
+struct UciInfo {
+    int depth = 0;
+    int selDepth = 0;
+    int multiPv = 1;
+    bool hasScore = false;
+    bool mate = false;          // score is "mate in N" (negative: getting mated)...
+    int score = 0;              // ...otherwise centipawns
+    bool lowerBound = false;    // the score is only a bound
+    bool upperBound = false;
+    int timeMs = 0;
+    uint64_t nodes = 0;
+    uint64_t nps = 0;
+    uint64_t tbHits = 0;
+    int hashFull = 0;           // permille
+    std::vector<std::string> pv;
+
+    void clear() {
+        // keep the pv's storage for the next line
+        pv.clear();
+        std::vector<std::string> moves = std::move(pv);
+        *this = UciInfo();
+        pv = std::move(moves);
+    }
+};
+
+// Turns engine output into lines as it arrives, hands every info line to a callback as a
+// UciInfo, and watches for the line a command is waiting for. Only the unfinished last line
+// is buffered, so memory stays bounded however long the engine searches; a line longer
+// than MAX_LINE (no real engine writes one) is cut short.
+class UciParser {
+public:
+    using InfoCallback = std::function<void(const UciInfo&)>;
+
+    static constexpr size_t MAX_LINE = 64 * 1024;
+
+    void setInfoCallback(InfoCallback callback) {
+        infoCallback = std::move(callback);
+    }
+
+    // Wait for a line starting with `token` (e.g. "bestmove", "readyok"); "" waits for nothing
+    void expect(const std::string &token) {
+        expected = token;
+        matched = false;
+        matchedLine.clear();
+    }
+
+    bool hasMatched() const {
+        return matched;
+    }
+
+    // The line that satisfied expect()
+    const std::string &getMatchedLine() const {
+        return matchedLine;
+    }
+
+    // Forget the previous search's result
+    void startSearch() {
+        analysis = Analysis();
+    }
+
+    // The running or last search's result: the last info line with a PV, then bestmove
+    const Analysis &getAnalysis() const {
+        return analysis;
+    }
+
+    // Feed engine output. Returns true once the expected line has arrived.
+    bool feed(const char *data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            char c = data[i];
+            if (c == '\n') {
+                if (!partial.empty() && partial.back() == '\r') {
+                    partial.pop_back();
+                }
+                handleLine(partial);
+                partial.clear();
+            } else if (partial.size() < MAX_LINE) {
+                partial += c;
+            }
+        }
+        return matched;
+    }
+
+private:
+    InfoCallback infoCallback;
+    std::string partial;        // output after the last newline
+    std::string expected;
+    bool matched = false;
+    std::string matchedLine;
+    UciInfo info;               // reused for every line
+    Analysis analysis;
+
+    static bool startsWith(std::string_view text, std::string_view prefix) {
+        return text.substr(0, prefix.size()) == prefix;
+    }
+
+    // Next space-separated token of `line` from `pos`; empty at the end
+    static std::string_view nextToken(std::string_view line, size_t &pos) {
+        while (pos < line.size() && line[pos] == ' ') {
+            ++pos;
+        }
+        size_t start = pos;
+        while (pos < line.size() && line[pos] != ' ') {
+            ++pos;
+        }
+        return line.substr(start, pos - start);
+    }
+
+    static long long toNumber(std::string_view token) {
+        long long value = 0;
+        bool negative = !token.empty() && token[0] == '-';
+        for (size_t i = negative ? 1 : 0; i < token.size() && token[i] >= '0' && token[i] <= '9'; ++i) {
+            value = value * 10 + (token[i] - '0');
+        }
+        return negative ? -value : value;
+    }
+
+    void handleLine(std::string_view line) {
+        if (startsWith(line, "info ")) {
+            handleInfo(line);
+        } else if (startsWith(line, "bestmove ")) {
+            size_t pos = 9; // Length of "bestmove "
+            analysis.bestMove = std::string(nextToken(line, pos));
+            analysis.ponderMove.clear();
+            if (nextToken(line, pos) == "ponder") {
+                analysis.ponderMove = std::string(nextToken(line, pos));
+            }
+        }
+        if (!matched && !expected.empty() && startsWith(line, expected)) {
+            matched = true;
+            matchedLine = std::string(line);
+        }
+    }
+
+    void handleInfo(std::string_view line) {
+        info.clear();
+        size_t pos = 5; // Length of "info "
+        for (std::string_view token = nextToken(line, pos); !token.empty(); token = nextToken(line, pos)) {
+            if (token == "string") {
+                // free text for humans to the end of the line
+                return;
+            } else if (token == "depth") {
+                info.depth = static_cast<int>(toNumber(nextToken(line, pos)));
+            } else if (token == "seldepth") {
+                info.selDepth = static_cast<int>(toNumber(nextToken(line, pos)));
+            } else if (token == "multipv") {
+                info.multiPv = static_cast<int>(toNumber(nextToken(line, pos)));
+            } else if (token == "score") {
+                info.hasScore = true;
+                info.mate = nextToken(line, pos) == "mate";
+                info.score = static_cast<int>(toNumber(nextToken(line, pos)));
+            } else if (token == "lowerbound") {
+                info.lowerBound = true;
+            } else if (token == "upperbound") {
+                info.upperBound = true;
+            } else if (token == "time") {
+                info.timeMs = static_cast<int>(toNumber(nextToken(line, pos)));
+            } else if (token == "nodes") {
+                info.nodes = static_cast<uint64_t>(toNumber(nextToken(line, pos)));
+            } else if (token == "nps") {
+                info.nps = static_cast<uint64_t>(toNumber(nextToken(line, pos)));
+            } else if (token == "tbhits") {
+                info.tbHits = static_cast<uint64_t>(toNumber(nextToken(line, pos)));
+            } else if (token == "hashfull") {
+                info.hashFull = static_cast<int>(toNumber(nextToken(line, pos)));
+            } else if (token == "pv") {
+                // the moves run to the end of the line
+                for (token = nextToken(line, pos); !token.empty(); token = nextToken(line, pos)) {
+                    info.pv.emplace_back(token);
+                }
+            }
+        }
+
+        if (info.nodes > 0) {
+            analysis.nodes = static_cast<long long>(info.nodes);
+        }
+        if (info.timeMs > 0) {
+            analysis.timeMs = info.timeMs;
+        }
+        // the main line's latest full iteration is the search's result so far
+        if (!info.pv.empty() && info.multiPv == 1 && !info.lowerBound && !info.upperBound) {
+            analysis.depth = info.depth;
+            analysis.mate = info.mate;
+            analysis.score = info.score;
+            analysis.pv = info.pv;
+        }
+        if (infoCallback) {
+            infoCallback(info);
+        }
+    }
+};
+
+#endif // UCIPARSER_H
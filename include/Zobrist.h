@@ -0,0 +1,24 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+
+// Random keys for the 64-bit position hash kept by Board
+namespace Zobrist {
+
+extern uint64_t pieceSquare[12][64]; // indexed by pieceTypeWithColor and square
+extern uint64_t enPassant[8];        // indexed by file of the en passant square
+extern uint64_t castling[16];        // indexed by the CastlingRights bit set
+extern uint64_t side;                // xor-ed in when black is to move
+
+// The Random64 table of the Polyglot book format, for Board::polyglotKey: 768 piece-square
+// keys, then 4 castling rights, 8 en passant files and the white-to-move key
+extern const uint64_t polyglot[781];
+
+// Fill the key tables from a fixed seed, so keys are stable across runs.
+// Safe to call more than once; only the first call does any work.
+void init();
+
+} // namespace Zobrist
+
+#endif // ZOBRIST_H
@@ -0,0 +1,230 @@
+// Protocol.h
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// The wire format between ChatClient and ChatServer. Every message is one frame:
+//
+//   length    u16   bytes after this field (at most MAX_FRAME)
+//   type      u8    a Type
+//   sequence  u32
+//   body      ...   depends on the type
+//
+// All integers are big-endian. Clients number their frames 1, 2, 3...; the server answers a
+// request (pong, error) with the request's sequence number, and numbers everything it sends
+// to a room with the room's event counter, so a client that sees a gap knows it missed
+// something and can ask for a sync.
+namespace protocol {
+
+enum class Type : uint8_t {
+    PING = 1,       // u64 sender's timestamp                       both ways; answered by PONG
+    PONG,           // u64 the ping's timestamp
+    JOIN,           // room name                                    client -> server
+    JOINED,         // u8 Role, then a SYNC body                    server -> client
+    LEAVE,          // empty                                        client -> server
+    MOVE,           // u16 move; from the server also u32 white ms, u32 black ms left
+    RESIGN,         // empty                                        client -> server
+    SYNC,           // client: empty (a request); server: u32 white ms, u32 black ms, FEN
+    RESULT,         // u8 Outcome, reason text                      server -> client
+    CHAT,           // client: text; server: u32 sender id, text
+    PRESENCE,       // u32 id, u8 Role, u8 1 if entered, 0 if left  server -> client
+    ERROR           // text                                         server -> client
+};
+
+enum class Role : uint8_t { WHITE, BLACK, SPECTATOR };
+enum class Outcome : uint8_t { WHITE_WINS, BLACK_WINS, DRAW };
+
+constexpr size_t HEADER_SIZE = 7;       // length, type, sequence
+constexpr size_t MAX_FRAME = 4096;      // largest length accepted
+constexpr size_t MAX_BODY = MAX_FRAME - (HEADER_SIZE - 2);
+constexpr size_t MAX_CHAT = MAX_BODY - 4;   // the server relays chat with the sender's id in front
+
+struct Frame {
+    Type type;
+    uint32_t sequence;
+    std::string body;
+};
+
+// Moves take two bytes: origin square in bits 0-5, destination in 6-11 (a1 = 0, h8 = 63)
+// and the promotion piece in 12-14 (0 none, 1 knight, 2 bishop, 3 rook, 4 queen)
+inline bool encode_move(std::string_view uci, uint16_t& move) {
+    if (uci.size() < 4 || uci.size() > 5) {
+        return false;
+    }
+    for (int i = 0; i < 4; i += 2) {
+        if (uci[i] < 'a' || uci[i] > 'h' || uci[i + 1] < '1' || uci[i + 1] > '8') {
+            return false;
+        }
+    }
+    int promotion = 0;
+    if (uci.size() == 5) {
+        size_t piece = std::string_view("nbrq").find(uci[4]);
+        if (piece == std::string_view::npos) {
+            return false;
+        }
+        promotion = static_cast<int>(piece) + 1;
+    }
+    const int from = (uci[1] - '1') * 8 + (uci[0] - 'a');
+    const int to = (uci[3] - '1') * 8 + (uci[2] - 'a');
+    move = static_cast<uint16_t>(from | (to << 6) | (promotion << 12));
+    return true;
+}
+
+inline std::string decode_move(uint16_t move) {
+    const int from = move & 63;
+    const int to = (move >> 6) & 63;
+    const int promotion = (move >> 12) & 7;
+    std::string uci;
+    uci += static_cast<char>('a' + from % 8);
+    uci += static_cast<char>('1' + from / 8);
+    uci += static_cast<char>('a' + to % 8);
+    uci += static_cast<char>('1' + to / 8);
+    if (promotion >= 1 && promotion <= 4) {
+        uci += "nbrq"[promotion - 1];
+    }
+    return uci;
+}
+
+// Builds a frame body field by field
+class Writer {
+public:
+    Writer& u8(uint8_t value) {
+        data_ += static_cast<char>(value);
+        return *this;
+    }
+    Writer& u16(uint16_t value) {
+        return u8(static_cast<uint8_t>(value >> 8)).u8(static_cast<uint8_t>(value));
+    }
+    Writer& u32(uint32_t value) {
+        return u16(static_cast<uint16_t>(value >> 16)).u16(static_cast<uint16_t>(value));
+    }
+    Writer& u64(uint64_t value) {
+        return u32(static_cast<uint32_t>(value >> 32)).u32(static_cast<uint32_t>(value));
+    }
+    // Runs to the end of the body, so it must come last
+    Writer& text(std::string_view value) {
+        data_.append(value.data(), value.size());
+        return *this;
+    }
+    const std::string& body() const {
+        return data_;
+    }
+
+private:
+    std::string data_;
+};
+
+// Reads a frame body field by field. Reading past the end yields zeros and clears ok().
+class Reader {
+public:
+    explicit Reader(std::string_view body) : data_(body) {}
+
+    uint8_t u8() {
+        if (pos_ >= data_.size()) {
+            ok_ = false;
+            return 0;
+        }
+        return static_cast<uint8_t>(data_[pos_++]);
+    }
+    uint16_t u16() {
+        uint16_t high = u8();
+        return static_cast<uint16_t>((high << 8) | u8());
+    }
+    uint32_t u32() {
+        uint32_t high = u16();
+        return (high << 16) | u16();
+    }
+    uint64_t u64() {
+        uint64_t high = u32();
+        return (high << 32) | u32();
+    }
+    std::string text() {
+        std::string rest(data_.substr(pos_));
+        pos_ = data_.size();
+        return rest;
+    }
+    bool ok() const {
+        return ok_;
+    }
+
+private:
+    std::string_view data_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+// Throws std::length_error for a body over MAX_BODY, which no decoder would accept
+inline std::string encode(Type type, uint32_t sequence, std::string_view body = {}) {
+    if (body.size() > MAX_BODY) {
+        throw std::length_error("frame body of " + std::to_string(body.size()) + " bytes");
+    }
+    const size_t length = HEADER_SIZE - 2 + body.size();
+    std::string frame;
+    frame.reserve(2 + length);
+    frame += static_cast<char>(length >> 8);
+    frame += static_cast<char>(length);
+    frame += static_cast<char>(type);
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        frame += static_cast<char>(sequence >> shift);
+    }
+    frame.append(body.data(), body.size());
+    return frame;
+}
+
+inline std::string encode(Type type, uint32_t sequence, const Writer& body) {
+    return encode(type, sequence, body.body());
+}
+
+// Cuts a byte stream into frames, however the bytes were split or run together on the way
+class Decoder {
+public:
+    void feed(const char* data, size_t size) {
+        buffer_.append(data, size);
+    }
+
+    // The next complete frame, if there is one. Returns false when more bytes are needed,
+    // or for good once a frame header is malformed (see failed).
+    bool next(Frame& frame) {
+        if (failed_ || buffer_.size() - pos_ < 2) {
+            return false;
+        }
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(buffer_.data() + pos_);
+        const size_t length = (static_cast<size_t>(bytes[0]) << 8) | bytes[1];
+        if (length < HEADER_SIZE - 2 || length > MAX_FRAME) {
+            failed_ = true;
+            return false;
+        }
+        if (buffer_.size() - pos_ < 2 + length) {
+            return false;
+        }
+        Reader header(std::string_view(buffer_).substr(pos_ + 2, HEADER_SIZE - 2));
+        frame.type = static_cast<Type>(header.u8());
+        frame.sequence = header.u32();
+        frame.body.assign(buffer_, pos_ + HEADER_SIZE, length - (HEADER_SIZE - 2));
+        pos_ += 2 + length;
+        // drop consumed bytes once they dominate, so the buffer stays about a frame long
+        if (pos_ > buffer_.size() / 2) {
+            buffer_.erase(0, pos_);
+            pos_ = 0;
+        }
+        return true;
+    }
+
+    // The stream broke the framing rules; the connection can't be trusted any more
+    bool failed() const {
+        return failed_;
+    }
+
+private:
+    std::string buffer_;
+    size_t pos_ = 0;
+    bool failed_ = false;
+};
+
+} // namespace protocol
+
+#endif // PROTOCOL_H
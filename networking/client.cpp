@@ -1,59 +1,267 @@
 // client.cpp
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <iostream>
 #include <string>
 #include <thread>
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include "Protocol.h"
 
 using boost::asio::ip::tcp;
 namespace ssl = boost::asio::ssl;
+using protocol::Frame;
+using protocol::Type;
 
+// Reads commands from the terminal, sends them to the server as frames (see Protocol.h)
+// and prints what the server sends back:
+//   join <room>   move <uci>   resign   sync   ping   say <text>   leave
+//
+// The TLS session the server hands out is kept in `session_file`, so the next run resumes it
+// with a short handshake instead of a full one.
 class ChatClient {
 public:
-    ChatClient(boost::asio::io_context& io_context, const std::string& host, const std::string& port)
-        : context_(ssl::context::sslv23_client),
-          socket_(io_context, context_) {
-        
+    ChatClient(boost::asio::io_context& io_context, const std::string& host, const std::string& port,
+               const std::string& session_file = "session.pem")
+        : io_context_(io_context),
+          context_(ssl::context::sslv23_client),
+          socket_(io_context, context_),
+          session_file_(session_file) {
+
         // Optionally, load a certificate for the client
         // socket_.set_verify_mode(ssl::verify_peer);
         // socket_.set_verify_callback(ssl::host_name_verification(host));
 
+        // the session cache only hands new sessions to save_session; this client makes one
+        // connection, so there is nothing to look up in memory
+        SSL_CTX* context = context_.native_handle();
+        SSL_set_ex_data(socket_.native_handle(), client_index(), this);
+        SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(context, &ChatClient::save_session);
+        SSL_CTX_set1_groups_list(context, "X25519:P-256");
+        SSL_set_tlsext_host_name(socket_.native_handle(), host.c_str());
+        load_session();
+
         tcp::resolver resolver(io_context);
         auto endpoints = resolver.resolve(host, port);
         boost::asio::connect(socket_.lowest_layer(), endpoints);
 
         socket_.handshake(ssl::stream_base::client);
+        std::cout << (SSL_session_reused(socket_.native_handle()) ? "Resumed TLS session" : "New TLS session") << std::endl;
         start_read();
     }
 
-    void write(const std::string& message) {
-        boost::asio::async_write(socket_, boost::asio::buffer(message),
+    // Turn a command line into a frame and send it; false if the line isn't a command
+    bool command(const std::string& line) {
+        const size_t space = line.find(' ');
+        const std::string name = line.substr(0, space);
+        const std::string argument = space == std::string::npos ? "" : line.substr(space + 1);
+
+        protocol::Writer body;
+        if (name == "join" && !argument.empty() && argument.size() <= protocol::MAX_BODY) {
+            send(Type::JOIN, body.text(argument));
+        } else if (name == "move") {
+            uint16_t move;
+            if (!protocol::encode_move(argument, move)) {
+                return false;
+            }
+            send(Type::MOVE, body.u16(move));
+        } else if (name == "say") {
+            if (argument.size() > protocol::MAX_CHAT) {
+                std::cerr << "Chat messages are limited to " << protocol::MAX_CHAT << " bytes" << std::endl;
+                return true;
+            }
+            send(Type::CHAT, body.text(argument));
+        } else if (name == "ping") {
+            send(Type::PING, body.u64(now_ms()));
+        } else if (name == "resign" || name == "sync" || name == "leave") {
+            send(name == "resign" ? Type::RESIGN : name == "sync" ? Type::SYNC : Type::LEAVE, body);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+private:
+    // Where the SSL object keeps its ChatClient (Asio has the app data slots)
+    static int client_index() {
+        static const int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+        return index;
+    }
+
+    // Offer the session saved by an earlier run, if there is one
+    void load_session() {
+        BIO* file = BIO_new_file(session_file_.c_str(), "r");
+        if (!file) {
+            return;
+        }
+        SSL_SESSION* session = PEM_read_bio_SSL_SESSION(file, nullptr, nullptr, nullptr);
+        BIO_free(file);
+        if (session) {
+            SSL_set_session(socket_.native_handle(), session);
+            SSL_SESSION_free(session);
+        }
+    }
+
+    // OpenSSL calls this for each session the server issues (with TLS 1.3, some time after
+    // the handshake); the latest one is kept for next time. The file holds the session's
+    // secret, so it is as sensitive as the connection itself.
+    static int save_session(SSL* ssl, SSL_SESSION* session) {
+        auto* client = static_cast<ChatClient*>(SSL_get_ex_data(ssl, client_index()));
+        BIO* file = BIO_new_file(client->session_file_.c_str(), "w");
+        if (file) {
+            PEM_write_bio_SSL_SESSION(file, session);
+            BIO_free(file);
+        }
+        return 0;   // not keeping a reference to the session
+    }
+
+    static uint64_t now_ms() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    static std::string format_clock(uint32_t ms) {
+        return std::to_string(ms / 60000) + ":" + std::to_string(ms / 10000 % 6) + std::to_string(ms / 1000 % 10);
+    }
+
+    // Callable from any thread: the write itself happens on the io_context's thread
+    void send(Type type, const protocol::Writer& body) {
+        boost::asio::post(io_context_, [this, type, body]() {
+            write_queue_.push_back(protocol::encode(type, ++sequence_, body));
+            if (write_queue_.size() == 1) {
+                start_write();
+            }
+        });
+    }
+
+    void start_write() {
+        // one write in flight at a time
+        boost::asio::async_write(socket_, boost::asio::buffer(write_queue_.front()),
             [this](boost::system::error_code ec, std::size_t /*length*/) {
                 if (ec) {
                     std::cerr << "Write error: " << ec.message() << std::endl;
                     socket_.lowest_layer().close();
+                    return;
+                }
+                write_queue_.pop_front();
+                if (!write_queue_.empty()) {
+                    start_write();
                 }
             });
     }
 
-private:
     void start_read() {
-        boost::asio::async_read_until(socket_, buffer_, '\n',
-            [this](boost::system::error_code ec, std::size_t /*length*/) {
-                if (!ec) {
-                    std::string message{std::istreambuf_iterator<char>(&buffer_), {}};
-                    std::cout << "Received: " << message;
-                    start_read();
-                } else {
+        socket_.async_read_some(boost::asio::buffer(read_buffer_),
+            [this](boost::system::error_code ec, std::size_t length) {
+                if (ec) {
                     std::cerr << "Read error: " << ec.message() << std::endl;
                     socket_.lowest_layer().close();
+                    return;
+                }
+                decoder_.feed(read_buffer_, length);
+                Frame frame;
+                while (decoder_.next(frame)) {
+                    print(frame);
+                }
+                if (decoder_.failed()) {
+                    std::cerr << "Read error: malformed frame" << std::endl;
+                    socket_.lowest_layer().close();
+                    return;
                 }
+                start_read();
             });
     }
 
+    // Room events are numbered one after another; after a gap the position is fetched again.
+    // An event numbered at or before the last one (e.g. still from a room just left) can't be
+    // counted as missed events, so it only triggers the fetch.
+    void track_event(uint32_t sequence) {
+        if (sequence > last_event_ + 1) {
+            std::cout << "Missed " << sequence - last_event_ - 1 << " events, syncing" << std::endl;
+            send(Type::SYNC, protocol::Writer());
+        } else if (sequence != last_event_ + 1) {
+            send(Type::SYNC, protocol::Writer());
+        }
+        last_event_ = sequence;
+    }
+
+    void print_state(protocol::Reader& body) {
+        const uint32_t white = body.u32();
+        const uint32_t black = body.u32();
+        std::cout << "Position " << body.text() << " (white " << format_clock(white)
+                  << ", black " << format_clock(black) << ")" << std::endl;
+    }
+
+    void print(const Frame& frame) {
+        static const char* roles[] = { "white", "black", "spectator" };
+        static const char* outcomes[] = { "1-0", "0-1", "1/2-1/2" };
+        protocol::Reader body(frame.body);
+        switch (frame.type) {
+            case Type::PING:
+                send(Type::PONG, protocol::Writer().text(frame.body));
+                break;
+            case Type::PONG:
+                std::cout << "Pong after " << now_ms() - body.u64() << " ms" << std::endl;
+                break;
+            case Type::JOINED:
+                std::cout << "Joined as " << roles[body.u8() % 3] << std::endl;
+                print_state(body);
+                last_event_ = frame.sequence;
+                break;
+            case Type::SYNC:
+                print_state(body);
+                last_event_ = frame.sequence;
+                break;
+            case Type::MOVE: {
+                track_event(frame.sequence);
+                const std::string move = protocol::decode_move(body.u16());
+                const uint32_t white = body.u32();
+                const uint32_t black = body.u32();
+                std::cout << "Moved " << move << " (white " << format_clock(white)
+                          << ", black " << format_clock(black) << ")" << std::endl;
+                break;
+            }
+            case Type::RESULT: {
+                track_event(frame.sequence);
+                const char* outcome = outcomes[body.u8() % 3];
+                std::cout << "Result " << outcome << " " << body.text() << std::endl;
+                break;
+            }
+            case Type::CHAT: {
+                track_event(frame.sequence);
+                const uint32_t id = body.u32();
+                std::cout << id << ": " << body.text() << std::endl;
+                break;
+            }
+            case Type::PRESENCE: {
+                track_event(frame.sequence);
+                const uint32_t id = body.u32();
+                const char* role = roles[body.u8() % 3];
+                std::cout << id << (body.u8() ? " entered as " : " left, was ") << role << std::endl;
+                break;
+            }
+            case Type::ERROR:
+                std::cout << "Error (request " << frame.sequence << "): " << frame.body << std::endl;
+                break;
+            default:
+                std::cout << "Unknown message type " << static_cast<int>(frame.type) << std::endl;
+                break;
+        }
+    }
+
+    boost::asio::io_context& io_context_;
     ssl::context context_;
     ssl::stream<tcp::socket> socket_;
-    boost::asio::streambuf buffer_;
+    const std::string session_file_;
+    char read_buffer_[4096];
+    protocol::Decoder decoder_;
+    std::deque<std::string> write_queue_;   // front is being written
+    uint32_t sequence_ = 0;                 // of the last frame sent
+    uint32_t last_event_ = 0;               // sequence of the last room event seen
 };
 
 int main() {
@@ -65,8 +273,9 @@ int main() {
 
         std::string message;
         while (std::getline(std::cin, message)) {
-            message += '\n';
-            client.write(message);
+            if (!message.empty() && !client.command(message)) {
+                std::cerr << "Commands: join <room>, move <uci>, resign, sync, ping, say <text>, leave" << std::endl;
+            }
         }
 
         io_context.stop();
@@ -75,4 +284,4 @@ int main() {
         std::cerr << "Exception: " << e.what() << std::endl;
     }
     return 0;
-}
\ No newline at end of file
+}
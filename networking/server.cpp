@@ -1,92 +1,704 @@
 // server.cpp
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <openssl/ssl.h>
+#include "Board.h"
+#include "GameClock.h"
+#include "Protocol.h"
 
 using boost::asio::ip::tcp;
 namespace ssl = boost::asio::ssl;
+using protocol::Frame;
+using protocol::Role;
+using protocol::Type;
+
+class ChatServer;
+class GameRoom;
+
+// One connected client. Everything touching its stream runs on the connection's own strand,
+// so each connection is served by one thread at a time while different connections (and
+// their TLS work) spread over the whole pool. Clients talk to it in the frames of Protocol.h.
+//
+// Outgoing frames wait in a queue and are written one at a time. A client that doesn't keep
+// up with its queue gets backpressure: past HIGH_WATER queued bytes its requests are no
+// longer read, and if the queue hasn't drained below LOW_WATER within SLOW_TIMEOUT, or ever
+// reaches MAX_QUEUED, the client is disconnected.
+class Session : public std::enable_shared_from_this<Session> {
+public:
+    Session(ChatServer& server, uint64_t id, tcp::socket socket, ssl::context& context)
+        : server_(server), id_(id), stream_(std::move(socket), context), slow_timer_(stream_.get_executor()) {}
+
+    uint64_t id() const {
+        return id_;
+    }
+
+    void start();
+
+    // Queue an encoded frame; safe to call from any thread. Broadcasts pass one shared frame
+    // to every recipient rather than a copy each.
+    void deliver(std::shared_ptr<const std::string> frame);
+    void deliver(std::string frame) {
+        deliver(std::make_shared<const std::string>(std::move(frame)));
+    }
+
+    // Close the connection; safe to call from any thread
+    void close();
+
+private:
+    static constexpr size_t HIGH_WATER = 64 * 1024;
+    static constexpr size_t LOW_WATER = 16 * 1024;
+    static constexpr size_t MAX_QUEUED = 1024 * 1024;
+    static constexpr std::chrono::seconds SLOW_TIMEOUT{ 10 };
+
+    void start_read();
+    void start_write();
+    void written(size_t size);
+    void start_slow_timer();
+    void handle_frame(const Frame& frame);
+    void send_error(uint32_t sequence, const std::string& text);
+    void leave_room();
+    void disconnect();
+
+    ChatServer& server_;
+    const uint64_t id_;
+    ssl::stream<tcp::socket> stream_;
+    std::string read_buffer_;
+    protocol::Decoder decoder_;
+    std::deque<std::shared_ptr<const std::string>> write_queue_; // front is being written
+    size_t queued_bytes_ = 0;
+    bool reading_ = false;      // a read is in flight; false while paused for backpressure
+    bool closed_ = false;
+    boost::asio::steady_timer slow_timer_;  // runs while the queue is above HIGH_WATER
+    bool slow_timer_running_ = false;
+    std::shared_ptr<GameRoom> room_;
+};
+
+// A game and everyone in it. The room's Board is the authority on the game: a move is only
+// played, and only sent on to the room, once the move generator has found it legal. Its
+// clock starts with white's first move; a flag is noticed on the next request to the room.
+class GameRoom {
+public:
+    GameRoom(std::string name, const TimeControl& control) : name_(std::move(name)), clock_(control) {
+        board_.initialize();
+    }
+
+    const std::string& name() const {
+        return name_;
+    }
+
+    // Seat a session (white, then black, then spectator) and send it the game so far
+    Role join(const std::shared_ptr<Session>& session) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        check_flag();
+        Role role = Role::SPECTATOR;
+        if (!seated(Role::WHITE)) {
+            role = Role::WHITE;
+        } else if (!seated(Role::BLACK)) {
+            role = Role::BLACK;
+        }
+        // announced first, so the newcomer's JOINED carries the latest event number
+        send_to_room(Type::PRESENCE, presence(session->id(), role, true));
+        members_[session->id()] = { session, role };
+        protocol::Writer joined;
+        joined.u8(static_cast<uint8_t>(role));
+        session->deliver(protocol::encode(Type::JOINED, events_, with_state(joined)));
+        return role;
+    }
+
+    // Returns whether the room is now empty
+    bool leave(uint64_t id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = members_.find(id);
+        if (it == members_.end()) {
+            return members_.empty();
+        }
+        const Role role = it->second.role;
+        members_.erase(it);
+        send_to_room(Type::PRESENCE, presence(id, role, false));
+        return members_.empty();
+    }
+
+    // Play the session's move if it is that player's turn and the move is legal, and tell
+    // the room. Otherwise the session alone gets an error answering request `sequence`.
+    void play(uint64_t id, uint32_t sequence, uint16_t wire_move) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = members_.find(id);
+        if (it == members_.end()) {
+            return;
+        }
+        check_flag();
+        Member& member = it->second;
+        const std::string uci = protocol::decode_move(wire_move);
+        std::string error;
+        PackedMove move;
+        if (finished_) {
+            error = "the game is over";
+        } else if (member.role == Role::SPECTATOR) {
+            error = "spectators can't move";
+        } else if ((member.role == Role::WHITE) != (board_.getSideToMove() == Color::WHITE)) {
+            error = "not your turn";
+        } else if (!parse_move(uci, move)) {
+            error = "illegal move " + uci;
+        } else if (board_.historySize >= Board::MAX_PLIES) {
+            error = "the game is too long";
+        }
+        if (!error.empty()) {
+            member.session->deliver(protocol::encode(Type::ERROR, sequence, error));
+            return;
+        }
+
+        if (!clock_.isRunning()) {
+            // white's clock starts with its first move, so that move is free
+            clock_.start(Color::WHITE);
+        }
+        board_.makeMove(move);
+        clock_.press();
+        // relay the move as played, which may differ from what was sent: a promotion without
+        // a piece became a queen, and promotion bits on any other move were ignored
+        uint16_t played = 0;
+        protocol::encode_move(move.toUci(), played);
+        protocol::Writer moved;
+        moved.u16(played);
+        send_to_room(Type::MOVE, with_clocks(moved));
+        end_if_over();
+    }
+
+    void resign(uint64_t id, uint32_t sequence) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = members_.find(id);
+        if (it == members_.end()) {
+            return;
+        }
+        check_flag();
+        const Role role = it->second.role;
+        if (finished_ || role == Role::SPECTATOR) {
+            it->second.session->deliver(protocol::encode(Type::ERROR, sequence,
+                finished_ ? "the game is over" : "spectators can't resign"));
+            return;
+        }
+        finish(role == Role::WHITE ? protocol::Outcome::BLACK_WINS : protocol::Outcome::WHITE_WINS, "resignation");
+    }
+
+    // Send the session the whole game as it stands, numbered with the last event it covers
+    void sync(uint64_t id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = members_.find(id);
+        if (it == members_.end()) {
+            return;
+        }
+        check_flag();
+        protocol::Writer state;
+        it->second.session->deliver(protocol::encode(Type::SYNC, events_, with_state(state)));
+    }
+
+    void say(uint64_t id, uint32_t sequence, const std::string& text) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = members_.find(id);
+        if (it == members_.end()) {
+            return;
+        }
+        if (text.size() > protocol::MAX_CHAT) {
+            it->second.session->deliver(protocol::encode(Type::ERROR, sequence,
+                "chat messages are limited to " + std::to_string(protocol::MAX_CHAT) + " bytes"));
+            return;
+        }
+        protocol::Writer chat;
+        chat.u32(static_cast<uint32_t>(id)).text(text);
+        send_to_room(Type::CHAT, chat);
+    }
+
+private:
+    struct Member {
+        std::shared_ptr<Session> session;
+        Role role;
+    };
+
+    bool seated(Role role) const {
+        return std::any_of(members_.begin(), members_.end(), [role](const auto& entry) {
+            return entry.second.role == role;
+        });
+    }
+
+    static protocol::Writer presence(uint64_t id, Role role, bool entered) {
+        protocol::Writer body;
+        body.u32(static_cast<uint32_t>(id)).u8(static_cast<uint8_t>(role)).u8(entered ? 1 : 0);
+        return body;
+    }
+
+    // Appends both clocks as they read now
+    protocol::Writer& with_clocks(protocol::Writer& body) const {
+        return body.u32(static_cast<uint32_t>(clock_.remainingMs(Color::WHITE)))
+                   .u32(static_cast<uint32_t>(clock_.remainingMs(Color::BLACK)));
+    }
+
+    // Appends the clocks and the position (the body of a SYNC)
+    protocol::Writer& with_state(protocol::Writer& body) const {
+        return with_clocks(body).text(board_.toFEN());
+    }
+
+    // One encoding of the event, numbered with the room's event counter and handed to
+    // every member
+    void send_to_room(Type type, const protocol::Writer& body) {
+        auto frame = std::make_shared<const std::string>(protocol::encode(type, ++events_, body));
+        for (auto& entry : members_) {
+            entry.second.session->deliver(frame);
+        }
+    }
+
+    // A legal move of the side to move in UCI notation; a pawn reaching the last rank
+    // without a promotion piece becomes a queen
+    bool parse_move(const std::string& uci, PackedMove& move) const {
+        const int from = (uci[1] - '1') * 8 + (uci[0] - 'a');
+        const int to = (uci[3] - '1') * 8 + (uci[2] - 'a');
+        PieceType promotion = PieceType::QUEEN;
+        if (uci.size() == 5) {
+            switch (uci[4]) {
+                case 'r': promotion = PieceType::ROOK; break;
+                case 'b': promotion = PieceType::BISHOP; break;
+                case 'n': promotion = PieceType::KNIGHT; break;
+                default: break;
+            }
+        }
+        if (board_.pieceOn(from) == pieceTypeWithColor::empty) {
+            return false;
+        }
+        MoveList legal;
+        board_.generateLegalMoves(board_.getSideToMove(), legal);
+        move = board_.toPackedMove(from, to, promotion);
+        return legal.contains(move);
+    }
+
+    void finish(protocol::Outcome outcome, const std::string& reason) {
+        finished_ = true;
+        clock_.stop();
+        protocol::Writer result;
+        result.u8(static_cast<uint8_t>(outcome)).text(reason);
+        send_to_room(Type::RESULT, result);
+    }
+
+    // The side to move loses once its clock has run out
+    void check_flag() {
+        const Color side = board_.getSideToMove();
+        if (!finished_ && clock_.isFlagged(side)) {
+            finish(side == Color::WHITE ? protocol::Outcome::BLACK_WINS : protocol::Outcome::WHITE_WINS, "time forfeit");
+        }
+    }
+
+    void end_if_over() {
+        const Color side = board_.getSideToMove();
+        MoveList legal;
+        board_.generateLegalMoves(side, legal);
+        if (legal.empty()) {
+            if (!board_.isCheck(side)) {
+                finish(protocol::Outcome::DRAW, "stalemate");
+            } else {
+                finish(side == Color::WHITE ? protocol::Outcome::BLACK_WINS : protocol::Outcome::WHITE_WINS, "checkmate");
+            }
+        } else if (board_.isThreefoldRepetition()) {
+            finish(protocol::Outcome::DRAW, "repetition");
+        } else if (board_.halfmoveClock >= 100) {
+            finish(protocol::Outcome::DRAW, "fifty-move rule");
+        }
+    }
+
+    const std::string name_;
+    std::mutex mutex_;
+    Board board_;
+    GameClock clock_;
+    bool finished_ = false;
+    uint32_t events_ = 0;       // frames sent to the whole room; the sequence number of the latest
+    std::unordered_map<uint64_t, Member> members_;
+};
 
 class ChatServer {
 public:
-    ChatServer(boost::asio::io_context& io_context, short port)
-        : acceptor_(io_context, tcp::endpoint(tcp::v4(), port)),
-          context_(ssl::context::sslv23_server) {
-        
+    // tls13_only refuses clients that can't speak TLS 1.3, whose handshake takes one round
+    // trip fewer than 1.2's
+    ChatServer(boost::asio::io_context& io_context, unsigned short port, const TimeControl& time_control,
+               bool tls13_only = false)
+        : io_context_(io_context),
+          acceptor_(boost::asio::make_strand(io_context), tcp::endpoint(tcp::v4(), port)),
+          context_(ssl::context::sslv23_server),
+          time_control_(time_control),
+          stats_timer_(acceptor_.get_executor()) {
+
         // Load SSL certificate and private key
         context_.use_certificate_chain_file("server.crt");
         context_.use_private_key_file("server.key", ssl::context::pem);
-        
+        configure_tls(tls13_only);
+
         acceptor_.set_option(tcp::acceptor::reuse_address(true));
         start_accept();
+        start_stats_timer();
+    }
+
+    // A client's handshake ended; `resumed` if it skipped the key exchange by resuming an
+    // earlier session
+    void count_handshake(bool ok, bool resumed) {
+        if (!ok) {
+            ++failed_handshakes_;
+        } else if (resumed) {
+            ++resumed_handshakes_;
+        } else {
+            ++full_handshakes_;
+        }
+    }
+
+    // A client finished its handshake
+    void add_client(std::shared_ptr<Session> session) {
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        clients_.emplace(session->id(), std::move(session));
+    }
+
+    void remove_client(uint64_t id) {
+        std::shared_ptr<Session> session;
+        {
+            std::lock_guard<std::mutex> lock(clients_mutex_);
+            auto it = clients_.find(id);
+            if (it == clients_.end()) {
+                return;
+            }
+            session = std::move(it->second);
+            clients_.erase(it);
+        }
+        session->close();
+    }
+
+    // Put the session in the named room, creating the room if nobody is in it
+    std::shared_ptr<GameRoom> join_room(const std::string& name, const std::shared_ptr<Session>& session) {
+        // held while joining, so the room can't be dropped as empty in between
+        std::lock_guard<std::mutex> lock(rooms_mutex_);
+        auto& room = rooms_[name];
+        if (!room) {
+            room = std::make_shared<GameRoom>(name, time_control_);
+        }
+        room->join(session);
+        return room;
+    }
+
+    void leave_room(const std::shared_ptr<GameRoom>& room, uint64_t id) {
+        std::lock_guard<std::mutex> lock(rooms_mutex_);
+        if (room->leave(id)) {
+            auto it = rooms_.find(room->name());
+            if (it != rooms_.end() && it->second == room) {
+                rooms_.erase(it);
+            }
+        }
     }
 
 private:
+    // Reconnecting clients resume their session instead of repeating the key exchange and
+    // certificate check: TLS 1.3 and 1.2 clients with a ticket, 1.2 clients without one from
+    // the session cache. The key exchange itself uses X25519, the cheapest ECDHE group, with
+    // P-256 for clients that lack it.
+    void configure_tls(bool tls13_only) {
+        SSL_CTX* context = context_.native_handle();
+        SSL_CTX_set_min_proto_version(context, tls13_only ? TLS1_3_VERSION : TLS1_2_VERSION);
+        SSL_CTX_set1_groups_list(context, "X25519:P-256");
+
+        static const unsigned char session_context[] = "chess-server";
+        SSL_CTX_set_session_id_context(context, session_context, sizeof(session_context) - 1);
+        SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(context, SESSION_CACHE_SIZE);
+        SSL_CTX_set_timeout(context, SESSION_LIFETIME_SECONDS);
+        // a client needs one ticket to reconnect; OpenSSL sends two by default
+        SSL_CTX_set_num_tickets(context, 1);
+    }
+
+    // Log the handshake counters every STATS_INTERVAL, when there were new handshakes
+    void start_stats_timer() {
+        stats_timer_.expires_after(STATS_INTERVAL);
+        stats_timer_.async_wait([this](boost::system::error_code ec) {
+            if (ec) {
+                return;
+            }
+            const uint64_t full = full_handshakes_, resumed = resumed_handshakes_, failed = failed_handshakes_;
+            if (full + resumed + failed != logged_handshakes_) {
+                logged_handshakes_ = full + resumed + failed;
+                const uint64_t done = full + resumed;
+                std::cout << "TLS handshakes: " << done << " (" << resumed << " resumed, "
+                          << (done ? resumed * 100 / done : 0) << "%), " << failed << " failed" << std::endl;
+            }
+            start_stats_timer();
+        });
+    }
+
     void start_accept() {
-        auto new_connection = std::make_shared<ssl::stream<tcp::socket>>(acceptor_.get_executor(), context_);
-        acceptor_.async_accept(new_connection->lowest_layer(),
-            [this, new_connection](boost::system::error_code ec) {
+        // every connection gets its own strand on the shared io_context
+        acceptor_.async_accept(boost::asio::make_strand(io_context_),
+            [this](boost::system::error_code ec, tcp::socket socket) {
                 if (!ec) {
                     std::cout << "New client connected" << std::endl;
-                    new_connection->async_handshake(ssl::stream_base::server,
-                        [this, new_connection](const boost::system::error_code& error) {
-                            if (!error) {
-                                clients_.push_back(new_connection);
-                                start_read(new_connection);
-                            }
-                        });
+                    std::make_shared<Session>(*this, next_id_++, std::move(socket), context_)->start();
                 }
                 start_accept();
             });
     }
 
-    void start_read(std::shared_ptr<ssl::stream<tcp::socket>> socket) {
-        auto buffer = std::make_shared<std::string>();
-        buffer->resize(1024);
-        socket->async_read_some(boost::asio::buffer(*buffer),
-            [this, socket, buffer](boost::system::error_code ec, std::size_t length) {
-                if (!ec) {
-                    buffer->resize(length);
-                    broadcast(*buffer, socket);
-                    start_read(socket);
-                } else {
-                    remove_client(socket);
-                }
-            });
+    static constexpr long SESSION_CACHE_SIZE = 20000;
+    static constexpr long SESSION_LIFETIME_SECONDS = 2 * 60 * 60;
+    static constexpr std::chrono::seconds STATS_INTERVAL{ 60 };
+
+    boost::asio::io_context& io_context_;
+    tcp::acceptor acceptor_;
+    ssl::context context_;
+    const TimeControl time_control_;   // for every new room
+    boost::asio::steady_timer stats_timer_;
+    std::atomic<uint64_t> full_handshakes_{ 0 };
+    std::atomic<uint64_t> resumed_handshakes_{ 0 };
+    std::atomic<uint64_t> failed_handshakes_{ 0 };
+    uint64_t logged_handshakes_ = 0;    // only touched by the stats timer, on the acceptor's strand
+    uint64_t next_id_ = 0;      // only touched by the accept handler, which runs on the acceptor's strand
+    std::mutex clients_mutex_;
+    std::unordered_map<uint64_t, std::shared_ptr<Session>> clients_;
+    std::mutex rooms_mutex_;    // taken before any room's own mutex
+    std::unordered_map<std::string, std::shared_ptr<GameRoom>> rooms_;
+};
+
+void Session::start() {
+    // the handshake runs on this connection's strand, so handshakes proceed in parallel
+    stream_.async_handshake(ssl::stream_base::server,
+        [self = shared_from_this()](const boost::system::error_code& error) {
+            self->server_.count_handshake(!error, !error && SSL_session_reused(self->stream_.native_handle()));
+            if (!error) {
+                self->server_.add_client(self);
+                self->start_read();
+            }
+        });
+}
+
+void Session::start_read() {
+    reading_ = true;
+    read_buffer_.resize(4096);
+    stream_.async_read_some(boost::asio::buffer(read_buffer_),
+        [self = shared_from_this()](boost::system::error_code ec, std::size_t length) {
+            self->reading_ = false;
+            if (ec) {
+                self->disconnect();
+                return;
+            }
+            self->decoder_.feed(self->read_buffer_.data(), length);
+            Frame frame;
+            while (self->decoder_.next(frame)) {
+                self->handle_frame(frame);
+            }
+            if (self->decoder_.failed()) {
+                // out of step with the client, so nothing more it sends can be read
+                self->disconnect();
+                return;
+            }
+            // a client that isn't reading its replies gets no more requests served until it does
+            if (self->queued_bytes_ <= HIGH_WATER && !self->closed_) {
+                self->start_read();
+            }
+        });
+}
+
+void Session::handle_frame(const Frame& frame) {
+    switch (frame.type) {
+        case Type::PING:
+            deliver(protocol::encode(Type::PONG, frame.sequence, frame.body));
+            return;
+        case Type::PONG:
+            return;
+        case Type::JOIN:
+            if (frame.body.empty()) {
+                send_error(frame.sequence, "no room name");
+                return;
+            }
+            leave_room();
+            room_ = server_.join_room(frame.body, shared_from_this());
+            return;
+        case Type::LEAVE:
+            leave_room();
+            return;
+        case Type::MOVE:
+        case Type::RESIGN:
+        case Type::SYNC:
+        case Type::CHAT:
+            break;
+        default:
+            send_error(frame.sequence, "unexpected message type " + std::to_string(static_cast<int>(frame.type)));
+            return;
     }
 
-    void broadcast(const std::string& message, std::shared_ptr<ssl::stream<tcp::socket>> sender) {
-        for (auto& client : clients_) {
-            if (client != sender) {
-                boost::asio::async_write(*client, boost::asio::buffer(message),
-                    [this, client](boost::system::error_code ec, std::size_t /*length*/) {
-                        if (ec) {
-                            remove_client(client);
-                        }
-                    });
+    if (!room_) {
+        send_error(frame.sequence, "join a room first");
+        return;
+    }
+    protocol::Reader body(frame.body);
+    switch (frame.type) {
+        case Type::MOVE: {
+            const uint16_t move = body.u16();
+            if (!body.ok()) {
+                send_error(frame.sequence, "malformed move");
+            } else {
+                room_->play(id_, frame.sequence, move);
             }
+            break;
         }
+        case Type::RESIGN:
+            room_->resign(id_, frame.sequence);
+            break;
+        case Type::SYNC:
+            room_->sync(id_);
+            break;
+        case Type::CHAT:
+            room_->say(id_, frame.sequence, frame.body);
+            break;
+        default:
+            send_error(frame.sequence, "unexpected message type " + std::to_string(static_cast<int>(frame.type)));
+            break;
     }
+}
+
+void Session::send_error(uint32_t sequence, const std::string& text) {
+    deliver(protocol::encode(Type::ERROR, sequence, text));
+}
 
-    void remove_client(std::shared_ptr<ssl::stream<tcp::socket>> socket) {
-        clients_.erase(std::remove(clients_.begin(), clients_.end(), socket), clients_.end());
-        socket->lowest_layer().close();
+void Session::leave_room() {
+    if (room_) {
+        server_.leave_room(room_, id_);
+        room_.reset();
     }
+}
 
-    tcp::acceptor acceptor_;
-    ssl::context context_;
-    std::vector<std::shared_ptr<ssl::stream<tcp::socket>>> clients_;
-};
+void Session::disconnect() {
+    closed_ = true;
+    leave_room();
+    server_.remove_client(id_);
+}
+
+void Session::deliver(std::shared_ptr<const std::string> frame) {
+    boost::asio::dispatch(stream_.get_executor(), [self = shared_from_this(), frame = std::move(frame)]() {
+        if (self->closed_) {
+            return;
+        }
+        self->queued_bytes_ += frame->size();
+        self->write_queue_.push_back(std::move(frame));
+        if (self->queued_bytes_ > MAX_QUEUED) {
+            std::cout << "Client " << self->id_ << " is too slow, disconnecting" << std::endl;
+            self->closed_ = true;
+            // deliver may be running inside a room's lock, which disconnecting takes again
+            boost::asio::post(self->stream_.get_executor(), [self]() { self->disconnect(); });
+            return;
+        }
+        if (self->queued_bytes_ > HIGH_WATER) {
+            self->start_slow_timer();
+        }
+        if (self->write_queue_.size() == 1) {
+            self->start_write();
+        }
+    });
+}
+
+void Session::start_slow_timer() {
+    if (slow_timer_running_) {
+        return;
+    }
+    slow_timer_running_ = true;
+    slow_timer_.expires_after(SLOW_TIMEOUT);
+    slow_timer_.async_wait([self = shared_from_this()](boost::system::error_code ec) {
+        if (ec) {
+            return;
+        }
+        self->slow_timer_running_ = false;
+        if (!self->closed_ && self->queued_bytes_ > LOW_WATER) {
+            std::cout << "Client " << self->id_ << " stayed too slow, disconnecting" << std::endl;
+            self->disconnect();
+        }
+    });
+}
+
+void Session::start_write() {
+    // a stream allows one write in flight, so frames go out one after another
+    boost::asio::async_write(stream_, boost::asio::buffer(*write_queue_.front()),
+        [self = shared_from_this()](boost::system::error_code ec, std::size_t /*length*/) {
+            if (ec) {
+                self->write_queue_.clear();
+                self->queued_bytes_ = 0;
+                self->disconnect();
+                return;
+            }
+            self->written(self->write_queue_.front()->size());
+            self->write_queue_.pop_front();
+            if (!self->write_queue_.empty()) {
+                self->start_write();
+            }
+        });
+}
+
+void Session::written(size_t size) {
+    queued_bytes_ -= size;
+    if (queued_bytes_ > LOW_WATER || closed_) {
+        return;
+    }
+    // caught up: stop the clock on it and serve its requests again
+    if (slow_timer_running_) {
+        slow_timer_running_ = false;
+        slow_timer_.cancel();
+    }
+    if (!reading_) {
+        start_read();
+    }
+}
+
+void Session::close() {
+    boost::asio::dispatch(stream_.get_executor(), [self = shared_from_this()]() {
+        self->closed_ = true;
+        self->slow_timer_.cancel();
+        // OpenSSL drops a session from the cache if the connection didn't end with a TLS
+        // shutdown, which clients that just vanish never do. Broken sessions were already
+        // dropped when the fatal alert went out.
+        SSL_set_shutdown(self->stream_.native_handle(), SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+        boost::system::error_code ignored;
+        self->stream_.lowest_layer().close(ignored);
+    });
+}
 
 int main() {
     try {
+        // rooms play under $CHESS_TIME_CONTROL, like games against the engine, but are timed
+        // (300+3) when it isn't set
+        const char* text = std::getenv("CHESS_TIME_CONTROL");
+        TimeControl time_control;
+        if (!TimeControl::parse(text ? text : "300+3", time_control)) {
+            std::cout << "can't read time control " << text << ", rooms play untimed" << std::endl;
+        }
+
+        // $CHESS_TLS13_ONLY=1 turns away clients without TLS 1.3
+        const char* tls13_only = std::getenv("CHESS_TLS13_ONLY");
+
         boost::asio::io_context io_context;
-        ChatServer server(io_context, 8080);
-        std::cout << "Server listening on port 8080" << std::endl;
+        ChatServer server(io_context, 8080, time_control, tls13_only && std::string(tls13_only) == "1");
+
+        // one thread per core, all running the same io_context
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        std::cout << "Server listening on port 8080 with " << threads << " threads" << std::endl;
+        std::vector<std::thread> pool;
+        for (unsigned i = 1; i < threads; ++i) {
+            pool.emplace_back([&io_context]() { io_context.run(); });
+        }
         io_context.run();
+        for (auto& thread : pool) {
+            thread.join();
+        }
     } catch (std::exception& e) {
         std::cerr << "Exception: " << e.what() << std::endl;
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,245 @@
+#include "AnalysisCache.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+// Start of the cache file; the records follow at RECORDS_OFFSET
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t slots;
+};
+
+const char FILE_MAGIC[8] = { 'C', 'H', 'S', 'C', 'A', 'C', 'H', 'E' };
+const uint32_t FILE_VERSION = 1;
+const size_t RECORDS_OFFSET = 64;
+
+// FNV-1a
+uint64_t hashString(const std::string& text, uint64_t hash = 14695981039346656037ull) {
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    return hash;
+}
+
+void copyMove(char (&to)[6], const std::string& move) {
+    std::memset(to, 0, sizeof(to));
+    std::memcpy(to, move.data(), std::min(move.size(), sizeof(to) - 1));
+}
+
+} // namespace
+
+AnalysisCache::AnalysisCache(size_t capacity, const std::string& path, size_t fileSlots) : capacity(std::max<size_t>(capacity, 1)) {
+    if (!path.empty() && !openFile(path, fileSlots)) {
+        std::cout << "analysis cache: can't use " << path << ", keeping results in memory only" << std::endl;
+    }
+}
+
+AnalysisCache::~AnalysisCache() {
+    flush();
+}
+
+std::string AnalysisCache::normalizeFEN(const std::string& fen) {
+    std::istringstream fields(fen);
+    std::string placement, side, castling, enPassant;
+    fields >> placement >> side >> castling >> enPassant;
+    return placement + ' ' + side + ' ' + castling + ' ' + enPassant;
+}
+
+uint32_t AnalysisCache::budgetOf(const SearchLimits& limits) {
+    if (limits.usesClock()) {
+        // how long the engine will think is up to it, so there is nothing to compare against
+        return 0;
+    }
+    if (limits.depth > 0) {
+        return static_cast<uint32_t>(limits.depth);
+    }
+    if (limits.movetimeMs > 0) {
+        return static_cast<uint32_t>(limits.movetimeMs);
+    }
+    return static_cast<uint32_t>(std::min<long long>((limits.nodes + 999) / 1000, UINT32_MAX));
+}
+
+uint64_t AnalysisCache::keyFor(const std::string& fen, const SearchLimits& limits) {
+    // results of different kinds of limit are filed apart, since they don't compare
+    const char* kind = limits.depth > 0 ? "depth" : limits.movetimeMs > 0 ? "movetime" : "nodes";
+    uint64_t key = hashString(kind, hashString(normalizeFEN(fen)));
+    return key ? key : 1; // 0 marks an empty file slot
+}
+
+bool AnalysisCache::lookup(const std::string& fen, const SearchLimits& limits, Analysis& analysis) {
+    const uint32_t budget = budgetOf(limits);
+    if (budget == 0) {
+        // an unbounded search is never answered from the cache
+        return false;
+    }
+    const uint64_t key = keyFor(fen, limits);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (Entry* entry = findEntry(key)) {
+        if (entry->budget >= budget) {
+            analysis = entry->analysis;
+            ++hits;
+            return true;
+        }
+        // too shallow in memory; the file may still hold a deeper result from an earlier run
+    }
+
+    Record* record = findRecord(key);
+    if (!record || record->budget < budget) {
+        ++misses;
+        return false;
+    }
+    Entry entry;
+    entry.budget = record->budget;
+    entry.analysis.depth = record->depth;
+    entry.analysis.mate = record->mate != 0;
+    entry.analysis.score = record->score;
+    entry.analysis.ponderMove = record->ponderMove;
+    for (int i = 0; i < std::min<int>(record->pvLength, MAX_PV); ++i) {
+        entry.analysis.pv.emplace_back(record->pv[i]);
+    }
+    if (!entry.analysis.pv.empty()) {
+        entry.analysis.bestMove = entry.analysis.pv.front();
+    }
+    insertEntry(key, entry);    // replaces a shallower memory entry
+    analysis = entry.analysis;
+    ++hits;
+    return true;
+}
+
+void AnalysisCache::store(const std::string& fen, const SearchLimits& limits, const Analysis& analysis) {
+    const uint32_t budget = budgetOf(limits);
+    if (budget == 0 || analysis.bestMove.empty()) {
+        return;
+    }
+    const uint64_t key = keyFor(fen, limits);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry* existing = findEntry(key);
+    if (existing && existing->budget > budget) {
+        return;
+    }
+    Entry entry{ budget, analysis };
+    if (entry.analysis.pv.empty() || entry.analysis.pv.front() != analysis.bestMove) {
+        entry.analysis.pv.assign(1, analysis.bestMove);
+    }
+    insertEntry(key, entry);
+    writeRecord(key, budget, entry.analysis);
+}
+
+void AnalysisCache::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    file.flush();
+}
+
+uint64_t AnalysisCache::getHits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
+
+uint64_t AnalysisCache::getMisses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
+
+bool AnalysisCache::openFile(const std::string& path, size_t slots) {
+    size_t count = PROBE_SLOTS;
+    while (count < slots) {
+        count <<= 1;
+    }
+    if (!file.openReadWrite(path, RECORDS_OFFSET + count * sizeof(Record))) {
+        return false;
+    }
+
+    FileHeader* header = reinterpret_cast<FileHeader*>(file.data());
+    if (std::memcmp(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header->version != FILE_VERSION
+        || header->recordSize != sizeof(Record) || header->slots != count) {
+        // new file, or one written by another version or with another size: start over
+        std::memset(file.data(), 0, file.size());
+        std::memcpy(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+        header->version = FILE_VERSION;
+        header->recordSize = sizeof(Record);
+        header->slots = count;
+    }
+    records = reinterpret_cast<Record*>(file.data() + RECORDS_OFFSET);
+    slotMask = count - 1;
+    return true;
+}
+
+AnalysisCache::Record* AnalysisCache::findRecord(uint64_t key) {
+    if (!records) {
+        return nullptr;
+    }
+    for (int i = 0; i < PROBE_SLOTS; ++i) {
+        Record& record = records[(key + i) & slotMask];
+        if (record.key == key) {
+            return &record;
+        }
+    }
+    return nullptr;
+}
+
+void AnalysisCache::writeRecord(uint64_t key, uint32_t budget, const Analysis& analysis) {
+    if (!records) {
+        return;
+    }
+    // the key's own slot if it has one, else a free slot, else the shallowest result
+    Record* target = nullptr;
+    for (int i = 0; i < PROBE_SLOTS; ++i) {
+        Record& record = records[(key + i) & slotMask];
+        if (record.key == key && record.budget > budget) {
+            return;
+        }
+        if (record.key == key || record.key == 0) {
+            target = &record;
+            break;
+        }
+        if (!target || record.depth < target->depth) {
+            target = &record;
+        }
+    }
+
+    Record record;
+    std::memset(&record, 0, sizeof(record));
+    record.key = key;
+    record.budget = budget;
+    record.score = analysis.score;
+    record.depth = static_cast<uint16_t>(analysis.depth);
+    record.mate = analysis.mate;
+    record.pvLength = static_cast<uint8_t>(std::min<size_t>(analysis.pv.size(), MAX_PV));
+    for (int i = 0; i < record.pvLength; ++i) {
+        copyMove(record.pv[i], analysis.pv[i]);
+    }
+    copyMove(record.ponderMove, analysis.ponderMove);
+    std::memcpy(target, &record, sizeof(record));
+}
+
+AnalysisCache::Entry* AnalysisCache::findEntry(uint64_t key) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        return nullptr;
+    }
+    // move to the front: most recently used
+    lru.splice(lru.begin(), lru, it->second);
+    return &it->second->second;
+}
+
+void AnalysisCache::insertEntry(uint64_t key, const Entry& entry) {
+    auto it = index.find(key);
+    if (it != index.end()) {
+        it->second->second = entry;
+        lru.splice(lru.begin(), lru, it->second);
+        return;
+    }
+    if (lru.size() >= capacity) {
+        index.erase(lru.back().first);
+        lru.pop_back();
+    }
+    lru.emplace_front(key, entry);
+    index[key] = lru.begin();
+}
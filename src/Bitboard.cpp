@@ -0,0 +1,153 @@
+#include "Bitboard.h"
+#include <initializer_list>
+
+namespace Bitboards {
+
+Bitboard knightAttacks[64];
+Bitboard kingAttacks[64];
+Bitboard pawnAttacks[2][64];
+Bitboard betweenBB[64][64];
+Bitboard lineBB[64][64];
+Magic rookMagics[64];
+Magic bishopMagics[64];
+
+namespace {
+
+// Set the bit for (row + dr, col + dc) if it is on the board
+Bitboard offsetBB(int square, int dr, int dc) {
+    int row = square / 8 + dr;
+    int col = square % 8 + dc;
+    if (row < 0 || row > 7 || col < 0 || col > 7) {
+        return 0;
+    }
+    return squareBB(row * 8 + col);
+}
+
+// Walk each ray until the edge of the board or the first blocker
+Bitboard slidingAttacks(int square, Bitboard occupied, const int (*directions)[2]) {
+    Bitboard attacks = 0;
+    for (int d = 0; d < 4; ++d) {
+        int row = square / 8 + directions[d][0];
+        int col = square % 8 + directions[d][1];
+        while (row >= 0 && row < 8 && col >= 0 && col < 8) {
+            Bitboard b = squareBB(row * 8 + col);
+            attacks |= b;
+            if (occupied & b) {
+                break;
+            }
+            row += directions[d][0];
+            col += directions[d][1];
+        }
+    }
+    return attacks;
+}
+
+const int rookDirections[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+const int bishopDirections[4][2] = { {1, 1}, {-1, -1}, {1, -1}, {-1, 1} };
+
+// Shared storage for every square's slice of the sliding attack tables
+Bitboard rookTable[0x19000];
+Bitboard bishopTable[0x1480];
+
+// xorshift64*; sparse candidates (few set bits) make good magics far more often
+uint64_t nextRandom(uint64_t& state) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
+
+// Fill the magic entries and their attack slices for one piece type, using the ray scan
+// as the reference. Magic search is seeded per rank so startup stays a few milliseconds.
+void initMagics(Magic magics[64], Bitboard* table, const int (*directions)[2]) {
+    static const uint64_t seeds[8] = { 728, 10316, 55013, 32803, 12281, 15100, 16645, 255 };
+    Bitboard occupancy[4096], reference[4096];
+    int epoch[4096] = {}, attempt = 0;
+    Bitboard* slice = table;
+
+    for (int sq = 0; sq < 64; ++sq) {
+        // board edges don't matter as blockers unless the piece stands on them
+        Bitboard edges = ((Rank1 | Rank8) & ~(Rank1 << (8 * (sq / 8))))
+                       | ((FileA | FileH) & ~(FileA << (sq % 8)));
+        Magic& m = magics[sq];
+        m.mask = slidingAttacks(sq, 0, directions) & ~edges;
+        m.shift = 64 - popcount(m.mask);
+        m.attacks = slice;
+
+        // enumerate every subset of the mask (Carry-Rippler) with its true attack set
+        int size = 0;
+        Bitboard b = 0;
+        do {
+            occupancy[size] = b;
+            reference[size] = slidingAttacks(sq, b, directions);
+#ifdef USE_PEXT
+            m.attacks[_pext_u64(b, m.mask)] = reference[size];
+#endif
+            ++size;
+            b = (b - m.mask) & m.mask;
+        } while (b);
+        slice += size;
+
+#ifndef USE_PEXT
+        // try sparse random numbers until one maps every subset without a harmful collision
+        uint64_t state = seeds[sq / 8];
+        for (int i = 0; i < size; ) {
+            for (m.magic = 0; popcount((m.magic * m.mask) >> 56) < 6; ) {
+                m.magic = nextRandom(state) & nextRandom(state) & nextRandom(state);
+            }
+            ++attempt;
+            for (i = 0; i < size; ++i) {
+                unsigned idx = m.index(occupancy[i]);
+                if (epoch[idx] < attempt) {
+                    epoch[idx] = attempt;
+                    m.attacks[idx] = reference[i];
+                } else if (m.attacks[idx] != reference[i]) {
+                    break;
+                }
+            }
+        }
+#endif
+    }
+}
+
+bool initTables() {
+    for (int sq = 0; sq < 64; ++sq) {
+        knightAttacks[sq] = offsetBB(sq, 2, 1) | offsetBB(sq, 2, -1) | offsetBB(sq, -2, 1) | offsetBB(sq, -2, -1)
+                          | offsetBB(sq, 1, 2) | offsetBB(sq, 1, -2) | offsetBB(sq, -1, 2) | offsetBB(sq, -1, -2);
+        kingAttacks[sq] = 0;
+        for (int dr = -1; dr <= 1; ++dr) {
+            for (int dc = -1; dc <= 1; ++dc) {
+                if (dr != 0 || dc != 0) {
+                    kingAttacks[sq] |= offsetBB(sq, dr, dc);
+                }
+            }
+        }
+        pawnAttacks[0][sq] = offsetBB(sq, 1, -1) | offsetBB(sq, 1, 1);
+        pawnAttacks[1][sq] = offsetBB(sq, -1, -1) | offsetBB(sq, -1, 1);
+    }
+    initMagics(rookMagics, rookTable, rookDirections);
+    initMagics(bishopMagics, bishopTable, bishopDirections);
+    for (int a = 0; a < 64; ++a) {
+        for (int b = 0; b < 64; ++b) {
+            betweenBB[a][b] = lineBB[a][b] = 0;
+            for (const int (*directions)[2] : { rookDirections, bishopDirections }) {
+                if (a != b && (slidingAttacks(a, 0, directions) & squareBB(b))) {
+                    lineBB[a][b] = (slidingAttacks(a, 0, directions) & slidingAttacks(b, 0, directions))
+                                 | squareBB(a) | squareBB(b);
+                    betweenBB[a][b] = slidingAttacks(a, squareBB(b), directions) & slidingAttacks(b, squareBB(a), directions);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void init() {
+    // function-local static: initialized exactly once, even with concurrent callers
+    static const bool initialized = initTables();
+    (void)initialized;
+}
+
+} // namespace Bitboards
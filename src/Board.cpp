@@ -1,10 +1,147 @@
 #include "Board.h"
 #include "Piece.h"
 #include <iostream>
+#include <stdexcept>
 
-Board::Board() : board(8, std::vector<std::shared_ptr<Piece>>(8, nullptr)), 
-                sideToMove(Color::WHITE), whiteKing(nullptr), blackKing(nullptr)
-{}
+using namespace Bitboards;
+
+namespace {
+
+// Castling rights that survive a move from or to each corner/king square
+uint8_t castlingMask(int square) {
+    switch (square) {
+        case 0:  return ALL_CASTLING & ~WHITE_OOO;
+        case 4:  return ALL_CASTLING & ~(WHITE_OO | WHITE_OOO);
+        case 7:  return ALL_CASTLING & ~WHITE_OO;
+        case 56: return ALL_CASTLING & ~BLACK_OOO;
+        case 60: return ALL_CASTLING & ~(BLACK_OO | BLACK_OOO);
+        case 63: return ALL_CASTLING & ~BLACK_OO;
+        default: return ALL_CASTLING;
+    }
+}
+
+// Piece on each square as implied by the bitboards
+void fillMailbox(const Bitboard byType[6], const Bitboard byColor[2], pieceTypeWithColor mailbox[64]) {
+    std::fill(mailbox, mailbox + 64, pieceTypeWithColor::empty);
+    for (int color = 0; color < 2; ++color) {
+        for (int type = 0; type < 6; ++type) {
+            for (Bitboard b = byType[type] & byColor[color]; b; ) {
+                mailbox[popLsb(b)] = makePiece(static_cast<PieceType>(type), static_cast<Color>(color));
+            }
+        }
+    }
+}
+
+std::string formatFEN(const pieceTypeWithColor mailbox[64], Color sideToMove, uint8_t castlingRights,
+                      int epSquare, int halfmoveClock, int fullmoveNumber) {
+    static const char pieceChars[] = "RNBQKPrnbqkp";
+    std::stringstream fen;
+
+    // Board position
+    for (int row = 7; row >= 0; --row) {
+        int emptyCount = 0;
+        for (int col = 0; col < 8; ++col) {
+            pieceTypeWithColor piece = mailbox[row * 8 + col];
+            if (piece != pieceTypeWithColor::empty) {
+                if (emptyCount > 0) {
+                    fen << emptyCount;
+                    emptyCount = 0;
+                }
+                fen << pieceChars[static_cast<int>(piece)];
+            } else {
+                ++emptyCount;
+            }
+        }
+        if (emptyCount > 0) {
+            fen << emptyCount;
+        }
+        if (row > 0) {
+            fen << '/';
+        }
+    }
+
+    // Side to move
+    fen << (sideToMove == Color::WHITE ? " w " : " b ");
+
+    // Castling rights
+    if (castlingRights == NO_CASTLING) {
+        fen << '-';
+    } else {
+        if (castlingRights & WHITE_OO) fen << 'K';
+        if (castlingRights & WHITE_OOO) fen << 'Q';
+        if (castlingRights & BLACK_OO) fen << 'k';
+        if (castlingRights & BLACK_OOO) fen << 'q';
+    }
+
+    // En passant target square
+    if (epSquare >= 0) {
+        fen << ' ' << static_cast<char>('a' + epSquare % 8) << static_cast<char>('1' + epSquare / 8);
+    } else {
+        fen << " -";
+    }
+
+    // Halfmove clock and fullmove number
+    fen << ' ' << halfmoveClock << ' ' << fullmoveNumber;
+
+    return fen.str();
+}
+
+const PieceType promotionTypes[] = { PieceType::QUEEN, PieceType::ROOK, PieceType::BISHOP, PieceType::KNIGHT };
+
+// Squares whose occupant a move changes (both ways: making and unmaking it)
+Bitboard changedSquares(PackedMove move) {
+    const int from = move.getFrom();
+    const int to = move.getTo();
+    Bitboard changed = squareBB(from) | squareBB(to);
+    if (move.getFlag() == PackedMove::CASTLING) {
+        changed |= squareBB(to > from ? from + 3 : from - 4) | squareBB((from + to) / 2);
+    } else if (move.getFlag() == PackedMove::EN_PASSANT) {
+        changed |= squareBB((from / 8) * 8 + to % 8);
+    }
+    return changed;
+}
+
+} // namespace
+
+Board::Board() : sideToMove(Color::WHITE), whiteKing(nullptr), blackKing(nullptr)
+{
+    Bitboards::init();
+    Zobrist::init();
+    std::fill(std::begin(mailbox), std::end(mailbox), pieceTypeWithColor::empty);
+}
+
+Board::Board(const Board& other) : Board() {
+    *this = other;
+}
+
+Board& Board::operator=(const Board& other) {
+    if (this == &other) {
+        return *this;
+    }
+    std::copy(std::begin(other.byType), std::end(other.byType), std::begin(byType));
+    std::copy(std::begin(other.byColor), std::end(other.byColor), std::begin(byColor));
+    std::copy(std::begin(other.mailbox), std::end(other.mailbox), std::begin(mailbox));
+    castlingRights = other.castlingRights;
+    epSquare = other.epSquare;
+    halfmoveClock = other.halfmoveClock;
+    fullmoveNumber = other.fullmoveNumber;
+    key = other.key;
+    sideToMove = other.sideToMove;
+    isInCheck = other.isInCheck;
+    std::copy(other.attackMap, other.attackMap + 2, attackMap);
+    std::copy(std::begin(other.attacksFrom), std::end(other.attacksFrom), std::begin(attacksFrom));
+    trackAttacks = other.trackAttacks;
+    std::copy(other.history, other.history + other.historySize, history);
+    historySize = other.historySize;
+    root = other.root;
+    changedPositions = other.changedPositions;
+    rebuildPieces();
+    return *this;
+}
+
+Board::Board(const BoardSnapshot& snapshot) : Board() {
+    loadSnapshot(snapshot);
+}
 
 // Destructor
 Board::~Board() {
@@ -18,81 +155,140 @@ Board::~Board() {
 
 // Initialize the board with pieces in the starting positions
 void Board::initialize() {
-    // Clear the board
-    for (auto& row : board) {
-        std::fill(row.begin(), row.end(), nullptr);
-    }
-
-    // Add pawns
-    for (int col = 0; col < 8; ++col) {
-        auto whitePawn = std::make_shared<Pawn>(Color::WHITE, Position(1, col));
-        auto blackPawn = std::make_shared<Pawn>(Color::BLACK, Position(6, col));
-        board[1][col] = whitePawn;
-        board[6][col] = blackPawn;
-        whitePieces.push_back(whitePawn);
-        blackPieces.push_back(blackPawn);
-    }
-
-    // Add rooks
-    auto whiteRook1 = std::make_shared<Rook>(Color::WHITE, Position(0, 0));
-    auto whiteRook2 = std::make_shared<Rook>(Color::WHITE, Position(0, 7));
-    auto blackRook1 = std::make_shared<Rook>(Color::BLACK, Position(7, 0));
-    auto blackRook2 = std::make_shared<Rook>(Color::BLACK, Position(7, 7));
-    board[0][0] = whiteRook1;
-    board[0][7] = whiteRook2;
-    board[7][0] = blackRook1;
-    board[7][7] = blackRook2;
-    whitePieces.push_back(whiteRook1);
-    whitePieces.push_back(whiteRook2);
-    blackPieces.push_back(blackRook1);
-    blackPieces.push_back(blackRook2);
-
-    // Add knights
-    auto whiteKnight1 = std::make_shared<Knight>(Color::WHITE, Position(0, 1));
-    auto whiteKnight2 = std::make_shared<Knight>(Color::WHITE, Position(0, 6));
-    auto blackKnight1 = std::make_shared<Knight>(Color::BLACK, Position(7, 1));
-    auto blackKnight2 = std::make_shared<Knight>(Color::BLACK, Position(7, 6));
-    board[0][1] = whiteKnight1;
-    board[0][6] = whiteKnight2;
-    board[7][1] = blackKnight1;
-    board[7][6] = blackKnight2;
-    whitePieces.push_back(whiteKnight1);
-    whitePieces.push_back(whiteKnight2);
-    blackPieces.push_back(blackKnight1);
-    blackPieces.push_back(blackKnight2);
-
-    // Add bishops
-    auto whiteBishop1 = std::make_shared<Bishop>(Color::WHITE, Position(0, 2));
-    auto whiteBishop2 = std::make_shared<Bishop>(Color::WHITE, Position(0, 5));
-    auto blackBishop1 = std::make_shared<Bishop>(Color::BLACK, Position(7, 2));
-    auto blackBishop2 = std::make_shared<Bishop>(Color::BLACK, Position(7, 5));
-    board[0][2] = whiteBishop1;
-    board[0][5] = whiteBishop2;
-    board[7][2] = blackBishop1;
-    board[7][5] = blackBishop2;
-    whitePieces.push_back(whiteBishop1);
-    whitePieces.push_back(whiteBishop2);
-    blackPieces.push_back(blackBishop1);
-    blackPieces.push_back(blackBishop2);
-
-    // Add queens
-    auto whiteQueen = std::make_shared<Queen>(Color::WHITE, Position(0, 3));
-    auto blackQueen = std::make_shared<Queen>(Color::BLACK, Position(7, 3));
-    board[0][3] = whiteQueen;
-    board[7][3] = blackQueen;
-    whitePieces.push_back(whiteQueen);
-    blackPieces.push_back(blackQueen);
-
-    // Add kings
-    whiteKing = std::make_shared<King>(Color::WHITE, Position(0, 4));
-    blackKing = std::make_shared<King>(Color::BLACK, Position(7, 4));
-    board[0][4] = whiteKing;
-    board[7][4] = blackKing;
-    whitePieces.push_back(whiteKing);
-    blackPieces.push_back(blackKing);
-
-    // Set the side to move
+    loadFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+}
+
+bool Board::loadFEN(const std::string& fen) {
+    historySize = 0;
+    changedPositions.clear();
+    std::fill(std::begin(byType), std::end(byType), 0);
+    std::fill(std::begin(byColor), std::end(byColor), 0);
+    std::fill(std::begin(mailbox), std::end(mailbox), pieceTypeWithColor::empty);
+    key = 0;
+    castlingRights = NO_CASTLING;
+    epSquare = -1;
+    halfmoveClock = 0;
+    fullmoveNumber = 1;
     sideToMove = Color::WHITE;
+
+    std::istringstream iss(fen);
+    std::string placement, side, castling, ep;
+    iss >> placement >> side >> castling >> ep;
+    // the clocks are optional
+    if (!(iss >> halfmoveClock) || halfmoveClock < 0) {
+        halfmoveClock = 0;
+    }
+    if (!(iss >> fullmoveNumber) || fullmoveNumber < 1) {
+        fullmoveNumber = 1;
+    }
+
+    // Piece placement, from rank 8 down to rank 1
+    static const std::string pieceChars = "RNBQKPrnbqkp";
+    int row = 7, col = 0;
+    for (char c : placement) {
+        if (c == '/') {
+            --row;
+            col = 0;
+        } else if (c >= '1' && c <= '8') {
+            col += c - '0';
+        } else {
+            std::string::size_type index = pieceChars.find(c);
+            if (index == std::string::npos || row < 0 || col > 7) {
+                loadFEN("8/8/8/8/8/8/8/8 w - - 0 1");
+                return false;
+            }
+            putPiece(static_cast<pieceTypeWithColor>(index), row * 8 + col);
+            ++col;
+        }
+    }
+    // more than 16 pieces a side can't come from a game and wouldn't fit the piece lists
+    if (popcount(byColor[0]) > PieceList::Capacity || popcount(byColor[1]) > PieceList::Capacity) {
+        loadFEN("8/8/8/8/8/8/8/8 w - - 0 1");
+        return false;
+    }
+    rebuildPieces();
+
+    if (side == "b") {
+        switchSideToMove();
+    }
+
+    for (char c : castling) {
+        switch (c) {
+            case 'K': castlingRights |= WHITE_OO; break;
+            case 'Q': castlingRights |= WHITE_OOO; break;
+            case 'k': castlingRights |= BLACK_OO; break;
+            case 'q': castlingRights |= BLACK_OOO; break;
+            default: break;
+        }
+    }
+    key ^= Zobrist::castling[castlingRights];
+
+    // Only keep an en passant square that can actually be captured on, as movePiece does,
+    // so the key matches the one reached by playing the moves
+    if (ep.size() == 2 && ep[0] >= 'a' && ep[0] <= 'h' && (ep[1] == '3' || ep[1] == '6')) {
+        int square = (ep[1] - '1') * 8 + (ep[0] - 'a');
+        if (pawnAttacks[static_cast<int>(getOppositeColor())][square] & pieces(sideToMove, PieceType::PAWN)) {
+            epSquare = square;
+            key ^= Zobrist::enPassant[epSquare % 8];
+        }
+    }
+    if (trackAttacks) {
+        refreshAttackMaps();
+    }
+    root = snapshot();
+    return true;
+}
+
+BoardSnapshot Board::snapshot() const {
+    BoardSnapshot snapshot;
+    std::copy(std::begin(byType), std::end(byType), snapshot.byType);
+    std::copy(std::begin(byColor), std::end(byColor), snapshot.byColor);
+    snapshot.key = key;
+    snapshot.halfmoveClock = static_cast<uint16_t>(halfmoveClock);
+    snapshot.fullmoveNumber = static_cast<uint16_t>(fullmoveNumber);
+    snapshot.epSquare = static_cast<int8_t>(epSquare);
+    snapshot.castlingRights = castlingRights;
+    snapshot.sideToMove = static_cast<uint8_t>(sideToMove);
+    return snapshot;
+}
+
+void Board::loadSnapshot(const BoardSnapshot& snapshot) {
+    std::copy(std::begin(snapshot.byType), std::end(snapshot.byType), byType);
+    std::copy(std::begin(snapshot.byColor), std::end(snapshot.byColor), byColor);
+    fillMailbox(byType, byColor, mailbox);
+    key = snapshot.key;
+    halfmoveClock = snapshot.halfmoveClock;
+    fullmoveNumber = snapshot.fullmoveNumber;
+    epSquare = snapshot.epSquare;
+    castlingRights = snapshot.castlingRights;
+    sideToMove = static_cast<Color>(snapshot.sideToMove);
+    historySize = 0;
+    root = snapshot;
+    changedPositions.clear();
+    if (trackAttacks) {
+        refreshAttackMaps();
+    }
+    rebuildPieces();
+}
+
+std::string Board::toFEN() const {
+    return formatFEN(mailbox, sideToMove, castlingRights, epSquare, halfmoveClock, fullmoveNumber);
+}
+
+std::string Board::getRootFEN() const {
+    pieceTypeWithColor rootMailbox[64];
+    fillMailbox(root.byType, root.byColor, rootMailbox);
+    return formatFEN(rootMailbox, static_cast<Color>(root.sideToMove), root.castlingRights, root.epSquare,
+                     root.halfmoveClock, root.fullmoveNumber);
+}
+
+std::vector<std::string> Board::uciMoves() const {
+    std::vector<std::string> moves;
+    moves.reserve(historySize);
+    for (int i = 0; i < historySize; ++i) {
+        moves.push_back(history[i].move.toUci());
+    }
+    return moves;
 }
 
 // Print the board (for debugging purposes)
@@ -112,140 +308,262 @@ void Board::printBoard() const {
 }
 
 // Move a piece from one position to another
-bool Board::movePiece(Position from, Position to, bool safetyCheck, bool undo) {
+bool Board::movePiece(Position from, Position to, bool safetyCheck, PieceType promotionType) {
     // std::cout << "movePiece: from " << from << " to " << to << std::endl;
-    if (safetyCheck && !undo) {
+    if (safetyCheck) {
         changedPositions.clear();
     }
     std::shared_ptr<Piece> piece = getPiece(from);
-    if (safetyCheck && !piece) {
-        std::cout << "you attempted to move a non-existent piece... don't do that again." << std::endl;
+    if (!piece) {
+        if (safetyCheck) {
+            std::cout << "you attempted to move a non-existent piece... don't do that again." << std::endl;
+        }
         return false;
     }
     if (safetyCheck && piece->getColor() != sideToMove) {
         std::cout << "you can't move your opponent's piece... srsly?" << std::endl;
         return false;
     }
+    if (safetyCheck && !(legalTargets(from.index()) & squareBB(to.index()))) {
+        std::cout << "move not found in piece's valid moves: " << from << " to " << to << std::endl;
+        return false;
+    }
+    if (historySize == MAX_PLIES) {
+        std::cout << "move history is full" << std::endl;
+        return false;
+    }
 
-    // if (!safetyCheck || piece && piece->isValidMove(*this, from, to)) {
-    if (!safetyCheck || piece) {
-        std::vector<Position> possibleMoves = piece->moves;
-        if (safetyCheck && std::find(possibleMoves.begin(), possibleMoves.end(), to) == possibleMoves.end()) {
-            std::cout << "move not found in piece's valid moves: " << from << " to " << to << std::endl;
-            return false;
-        }
-
-        // handle castling
-        bool castling = false;
-        if (piece->getType() == PieceType::KING && piece->isCastling(to)) {
-            castling = true;
-            std::cout << "castling detected" << std::endl;
-            std::shared_ptr<Piece> rook = nullptr;
-            Position rookInitialPos;
-            Position rookFinalPos;
-            if (sideToMove == Color::WHITE) {
-                if (to.col == 2) {
-                    rookInitialPos = Position(0, 0);
-                    rookFinalPos = Position(0, 3);
-                    rook = getPiece(rookInitialPos);
-                } else if (to.col == 6) {
-                    rookInitialPos = Position(0, 7);
-                    rookFinalPos = Position(0, 5);
-                    rook = getPiece(rookInitialPos);
-                    if(!rook) {
-                        std::cout << "no rook found for castling" << std::endl;
-                        return false;
-                    }
-                }
-            } else {
-                if (to.col == 2) {
-                    rookInitialPos = Position(7, 0);
-                    rookFinalPos = Position(7, 3);
-                    rook = getPiece(rookInitialPos);
-                } else if (to.col == 6) {
-                    rookInitialPos = Position(7, 7);
-                    rookFinalPos = Position(7, 5);
-                    rook = getPiece(rookInitialPos);
-                }
-            }
-            if (!rook) {
-                std::cout << "no rook found for castling" << std::endl;
-                return false;
-            }
-            board[rookFinalPos.row][rookFinalPos.col] = rook;
-            stringBoard[rookFinalPos.row * 8 + rookFinalPos.col] = piece2string(rook);
-            board[rookInitialPos.row][rookInitialPos.col] = nullptr;
-            stringBoard[rookInitialPos.row * 8 + rookInitialPos.col] = " ";
-            rook->setPosition(rookFinalPos);
-            if (safetyCheck && !undo) {
-                changedPositions.emplace_back(std::make_pair(rookInitialPos.row*8 + rookInitialPos.col, static_cast<int>(pieceTypeWithColor::empty)));
-                changedPositions.emplace_back(std::make_pair(rookFinalPos.row*8 + rookFinalPos.col, static_cast<int>(rook->getPieceTypeWithColor())));
-            }
-        }
+    PackedMove move = toPackedMove(from.index(), to.index(), promotionType);
+    const int rookFrom = to.col > from.col ? from.index() + 3 : from.index() - 4;
+    const int rookTo = (from.index() + to.index()) / 2;
+    if (move.getFlag() == PackedMove::CASTLING && mailbox[rookFrom] != makePiece(PieceType::ROOK, piece->getColor())) {
+        std::cout << "no rook found for castling" << std::endl;
+        return false;
+    }
+    const int captureSquare = move.getFlag() == PackedMove::EN_PASSANT ? Position(from.row, to.col).index() : to.index();
+    std::shared_ptr<Piece> targetPiece = getPiece(Position(captureSquare));
 
-        bool promotion = false;
-        std::shared_ptr<Piece> promotionPiece = nullptr;
-        if (safetyCheck && piece->getType() == PieceType::PAWN && (to.row == 0 || to.row == 7)) {
-            promotion = true;
-        }
-        if (promotion) {
-            promotionPiece = std::make_shared<Queen>(piece->getColor(), to);
-            if (!undo) {
-                moves.emplace_back(new Move(from, to, piece, nullptr, castling, promotion));
-                if(safetyCheck) piece->hasMoved = true;
-                std::cout << "move history size: " << moves.size() << std::endl;
-            }
-            // remove pawn from board
-            removePiece(piece);
-            // add queen to board
-            if(promotionPiece->getColor() == Color::WHITE) {
-                whitePieces.push_back(promotionPiece);
-            } else {
-                blackPieces.push_back(promotionPiece);
-            }
-            board[to.row][to.col] = promotionPiece;
-            stringBoard[to.row * 8 + to.col] = piece2string(promotionPiece);
+    makeMove(move);
 
-            if (safetyCheck && !undo) {
-                changedPositions.emplace_back(std::make_pair(from.row*8 + from.col, static_cast<int>(pieceTypeWithColor::empty)));
-                changedPositions.emplace_back(std::make_pair(to.row*8 + to.col, static_cast<int>(promotionPiece->getPieceTypeWithColor())));
-            }
-        } else {
-            std::shared_ptr<Piece> targetPiece = getPiece(to);
-            if (!undo) {
-                moves.emplace_back(new Move(from, to, piece, targetPiece, castling, promotion));
-                if(safetyCheck) piece->hasMoved = true;
-                std::cout << "move history size: " << moves.size() << std::endl;
-            }
-            if (targetPiece) {
-                removePiece(targetPiece);
-            }
-            board[to.row][to.col] = piece;
-            stringBoard[to.row * 8 + to.col] = piece2string(piece);
-            board[from.row][from.col] = nullptr;
-            stringBoard[from.row * 8 + from.col] = " ";
-            piece->setPosition(to);
-            if (safetyCheck && !undo) {
-                changedPositions.emplace_back(std::make_pair(from.row*8 + from.col, static_cast<int>(pieceTypeWithColor::empty)));
-                changedPositions.emplace_back(std::make_pair(to.row*8 + to.col, static_cast<int>(piece->getPieceTypeWithColor())));
-            }
+    // Bring the Piece objects in line with the core
+    if (targetPiece) {
+        setGridPiece(captureSquare, nullptr);
+        unlistPiece(targetPiece);
+    }
+    if (move.getFlag() == PackedMove::CASTLING) {
+        std::shared_ptr<Piece> rook = getPiece(Position(rookFrom));
+        setGridPiece(rookFrom, nullptr);
+        setGridPiece(rookTo, rook);
+    }
+    setGridPiece(from.index(), nullptr);
+    if (move.getFlag() == PackedMove::PROMOTION) {
+        unlistPiece(piece);
+        std::shared_ptr<Piece> promotionPiece = PieceArena::create(promotionType, piece->getColor(), to);
+        (promotionPiece->getColor() == Color::WHITE ? whitePieces : blackPieces).push_back(promotionPiece);
+        setGridPiece(to.index(), promotionPiece);
+    } else {
+        setGridPiece(to.index(), piece);
+    }
+
+    if (safetyCheck) {
+        piece->hasMoved = true;
+        changedPositions.emplace_back(std::make_pair(from.index(), static_cast<int>(pieceTypeWithColor::empty)));
+        changedPositions.emplace_back(std::make_pair(to.index(), static_cast<int>(mailbox[to.index()])));
+        if (move.getFlag() == PackedMove::EN_PASSANT) {
+            changedPositions.emplace_back(std::make_pair(captureSquare, static_cast<int>(pieceTypeWithColor::empty)));
+        }
+        if (move.getFlag() == PackedMove::CASTLING) {
+            changedPositions.emplace_back(std::make_pair(rookFrom, static_cast<int>(pieceTypeWithColor::empty)));
+            changedPositions.emplace_back(std::make_pair(rookTo, static_cast<int>(mailbox[rookTo])));
         }
-        switchSideToMove();
-        return true;
     }
-    return false;
+    return true;
 }
+
 bool Board::undoMove() {
-    // std::cout << "undoing move..." << std::endl;
-    if (moves.empty()) {
+    if (historySize == 0) {
         return false;
     }
-    // std::cout << "undoMove: move history size: " << moves.size() << std::endl;
-    Move* lastMove = moves.back();
-    moves.pop_back();
-    lastMove->undo(*this);
-    delete lastMove;
-    // std::cout << "undoMove: move history size2: " << moves.size() << std::endl;
+    const StateInfo& st = history[historySize - 1];
+    const PackedMove move = st.move;
+    const int from = move.getFrom();
+    const int to = move.getTo();
+    const int captureSquare = move.getFlag() == PackedMove::EN_PASSANT ? (from / 8) * 8 + to % 8 : to;
+    const pieceTypeWithColor captured = st.captured;
+
+    unmakeMove();
+
+    // Bring the Piece objects in line with the core
+    std::shared_ptr<Piece> piece = getPiece(Position(to));
+    setGridPiece(to, nullptr);
+    if (move.getFlag() == PackedMove::PROMOTION) {
+        unlistPiece(piece);
+        Color color = piece->getColor();
+        piece = PieceArena::create(PieceType::PAWN, color, Position(from));
+        (piece->getColor() == Color::WHITE ? whitePieces : blackPieces).push_back(piece);
+    }
+    setGridPiece(from, piece);
+    if (move.getFlag() == PackedMove::CASTLING) {
+        int rookFrom = to > from ? from + 3 : from - 4;
+        int rookTo = (from + to) / 2;
+        std::shared_ptr<Piece> rook = getPiece(Position(rookTo));
+        setGridPiece(rookTo, nullptr);
+        setGridPiece(rookFrom, rook);
+    }
+    if (captured != pieceTypeWithColor::empty) {
+        std::shared_ptr<Piece> restored = PieceArena::create(typeOf(captured), colorOf(captured), Position(captureSquare));
+        (restored->getColor() == Color::WHITE ? whitePieces : blackPieces).push_back(restored);
+        setGridPiece(captureSquare, restored);
+    }
+    return true;
+}
+
+PackedMove Board::toPackedMove(int from, int to, PieceType promotionType) const {
+    PieceType type = typeOf(mailbox[from]);
+    if (type == PieceType::KING && std::abs(to % 8 - from % 8) == 2) {
+        return PackedMove(from, to, PackedMove::CASTLING);
+    }
+    if (type == PieceType::PAWN) {
+        if (to / 8 == 0 || to / 8 == 7) {
+            return PackedMove(from, to, PackedMove::PROMOTION, promotionType);
+        }
+        if (to == epSquare && from % 8 != to % 8) {
+            return PackedMove(from, to, PackedMove::EN_PASSANT);
+        }
+    }
+    return PackedMove(from, to);
+}
+
+void Board::makeMove(PackedMove move) {
+    const int from = move.getFrom();
+    const int to = move.getTo();
+    const pieceTypeWithColor piece = mailbox[from];
+    const Color us = colorOf(piece);
+    const PieceType type = typeOf(piece);
+
+    if (historySize == MAX_PLIES) {
+        throw std::length_error("move history is full");
+    }
+    StateInfo& st = history[historySize++];
+    st.key = key;
+    st.move = move;
+    st.captured = pieceTypeWithColor::empty;
+    st.castlingRights = castlingRights;
+    st.epSquare = static_cast<int8_t>(epSquare);
+    st.halfmoveClock = static_cast<uint16_t>(halfmoveClock);
+
+    if (move.getFlag() == PackedMove::CASTLING) {
+        // the rook jumps over the king
+        int rookFrom = to > from ? from + 3 : from - 4;
+        pieceTypeWithColor rook = mailbox[rookFrom];
+        clearSquare(rookFrom);
+        putPiece(rook, (from + to) / 2);
+    } else {
+        // the captured piece sits on `to`, except for en passant where it is behind it
+        int captureSquare = move.getFlag() == PackedMove::EN_PASSANT ? (from / 8) * 8 + to % 8 : to;
+        st.captured = mailbox[captureSquare];
+        clearSquare(captureSquare);
+    }
+    clearSquare(from);
+    putPiece(move.getFlag() == PackedMove::PROMOTION ? makePiece(move.getPromotionType(), us) : piece, to);
+
+    // update castling rights, the en passant square and the fifty-move counter
+    key ^= Zobrist::castling[castlingRights];
+    castlingRights &= castlingMask(from) & castlingMask(to);
+    key ^= Zobrist::castling[castlingRights];
+    if (epSquare >= 0) {
+        key ^= Zobrist::enPassant[epSquare % 8];
+        epSquare = -1;
+    }
+    if (type == PieceType::PAWN && std::abs(to - from) == 16) {
+        int passed = (from + to) / 2;
+        Color them = us == Color::WHITE ? Color::BLACK : Color::WHITE;
+        if (pawnAttacks[static_cast<int>(us)][passed] & pieces(them, PieceType::PAWN)) {
+            epSquare = passed;
+            key ^= Zobrist::enPassant[epSquare % 8];
+        }
+    }
+    halfmoveClock = (type == PieceType::PAWN || st.captured != pieceTypeWithColor::empty) ? 0 : halfmoveClock + 1;
+    if (us == Color::BLACK) {
+        ++fullmoveNumber;
+    }
+    switchSideToMove();
+    if (trackAttacks) {
+        updateAttackMaps(changedSquares(move));
+    }
+}
+
+void Board::unmakeMove() {
+    const StateInfo& st = history[--historySize];
+    const PackedMove move = st.move;
+    const int from = move.getFrom();
+    const int to = move.getTo();
+    const pieceTypeWithColor piece = mailbox[to];
+
+    clearSquare(to);
+    putPiece(move.getFlag() == PackedMove::PROMOTION ? makePiece(PieceType::PAWN, colorOf(piece)) : piece, from);
+    if (move.getFlag() == PackedMove::CASTLING) {
+        int rookFrom = to > from ? from + 3 : from - 4;
+        int rookTo = (from + to) / 2;
+        pieceTypeWithColor rook = mailbox[rookTo];
+        clearSquare(rookTo);
+        putPiece(rook, rookFrom);
+    } else if (st.captured != pieceTypeWithColor::empty) {
+        putPiece(st.captured, move.getFlag() == PackedMove::EN_PASSANT ? (from / 8) * 8 + to % 8 : to);
+    }
+
+    castlingRights = st.castlingRights;
+    epSquare = st.epSquare;
+    halfmoveClock = st.halfmoveClock;
+    sideToMove = sideToMove == Color::WHITE ? Color::BLACK : Color::WHITE;
+    if (sideToMove == Color::BLACK) {
+        --fullmoveNumber;
+    }
+    key = st.key;
+    if (trackAttacks) {
+        updateAttackMaps(changedSquares(move));
+    }
+}
+
+int Board::repetitionCount() const {
+    int count = 0;
+    int end = std::min(halfmoveClock, historySize);
+    // history[historySize - i] holds the key from i plies ago; only the same side to move can repeat
+    for (int i = 4; i <= end; i += 2) {
+        if (history[historySize - i].key == key) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+uint64_t Board::polyglotKey() const {
+    // Polyglot orders pieces pawn, knight, bishop, rook, queen, king, black before white
+    static const int polyglotType[6] = { 3, 1, 2, 4, 5, 0 }; // indexed by PieceType
+    uint64_t result = 0;
+    for (int piece = 0; piece < 12; ++piece) {
+        const PieceType type = typeOf(static_cast<pieceTypeWithColor>(piece));
+        const Color color = colorOf(static_cast<pieceTypeWithColor>(piece));
+        const int kind = 2 * polyglotType[static_cast<int>(type)] + (color == Color::WHITE ? 1 : 0);
+        Bitboard bb = pieces(color, type);
+        while (bb) {
+            result ^= Zobrist::polyglot[64 * kind + Bitboards::popLsb(bb)];
+        }
+    }
+    // the castling bits are in Polyglot's order: white short, white long, black short, black long
+    for (int bit = 0; bit < 4; ++bit) {
+        if (castlingRights & (1 << bit)) {
+            result ^= Zobrist::polyglot[768 + bit];
+        }
+    }
+    // epSquare is only set when a pawn can capture there, which is Polyglot's rule too
+    if (epSquare >= 0) {
+        result ^= Zobrist::polyglot[772 + epSquare % 8];
+    }
+    if (sideToMove == Color::WHITE) {
+        result ^= Zobrist::polyglot[780];
+    }
+    return result;
 }
 
 // Get the piece at a specific position
@@ -259,14 +577,17 @@ std::shared_ptr<Piece> Board::getPiece(Position pos) const {
 // Add a piece to a specific position
 void Board::addPiece(std::shared_ptr<Piece> piece, Position pos) {
     if (isValidPosition(pos)) {
-        board[pos.row][pos.col] = piece;
-        stringBoard[pos.row * 8 + pos.col] = piece2string(piece);
-        piece->setPosition(pos);
+        // listed first: a full list throws before the board is touched
         if (piece->getColor() == Color::WHITE) {
             whitePieces.push_back(piece);
         } else {
             blackPieces.push_back(piece);
         }
+        setGridPiece(pos.index(), piece);
+        putPiece(piece->getPieceTypeWithColor(), pos.index());
+        if (trackAttacks) {
+            updateAttackMaps(squareBB(pos.index()));
+        }
     }
 }
 
@@ -274,13 +595,48 @@ void Board::addPiece(std::shared_ptr<Piece> piece, Position pos) {
 void Board::removePiece(std::shared_ptr<Piece> piece) {
     Position pos = piece->getPosition();
     if (isValidPosition(pos) && board[pos.row][pos.col] == piece) {
-        board[pos.row][pos.col] = nullptr;
-        stringBoard[pos.row * 8 + pos.col] = " ";
+        setGridPiece(pos.index(), nullptr);
+        clearSquare(pos.index());
+        if (trackAttacks) {
+            updateAttackMaps(squareBB(pos.index()));
+        }
     }
-    if (piece->getColor() == Color::WHITE) {
-        whitePieces.erase(std::remove(whitePieces.begin(), whitePieces.end(), piece), whitePieces.end());
-    } else {
-        blackPieces.erase(std::remove(blackPieces.begin(), blackPieces.end(), piece), blackPieces.end());
+    unlistPiece(piece);
+}
+
+void Board::setGridPiece(int square, std::shared_ptr<Piece> piece) {
+    Position pos(square);
+    board[pos.row][pos.col] = piece;
+    stringBoard[square] = piece ? piece2string(piece) : " ";
+    if (piece) {
+        piece->setPosition(pos);
+    }
+}
+
+void Board::unlistPiece(std::shared_ptr<Piece> piece) {
+    (piece->getColor() == Color::WHITE ? whitePieces : blackPieces).remove(piece);
+}
+
+void Board::rebuildPieces() {
+    for (auto& row : board) {
+        row.fill(nullptr);
+    }
+    whitePieces.clear();
+    blackPieces.clear();
+    whiteKing = nullptr;
+    blackKing = nullptr;
+    for (int square = 0; square < 64; ++square) {
+        pieceTypeWithColor piece = mailbox[square];
+        if (piece == pieceTypeWithColor::empty) {
+            stringBoard[square] = " ";
+            continue;
+        }
+        std::shared_ptr<Piece> newPiece = PieceArena::create(typeOf(piece), colorOf(piece), Position(square));
+        setGridPiece(square, newPiece);
+        (colorOf(piece) == Color::WHITE ? whitePieces : blackPieces).push_back(newPiece);
+        if (typeOf(piece) == PieceType::KING) {
+            (colorOf(piece) == Color::WHITE ? whiteKing : blackKing) = newPiece;
+        }
     }
 }
 
@@ -300,19 +656,147 @@ void Board::demotePiece(Position pos, std::shared_ptr<Piece> pawnPiece) {
     }
 }
 
-// Check if a move puts the player in check
-bool Board::isCheck(Color color) const {
-    Position kingPos = (color == Color::WHITE) ? whiteKing->getPosition() : blackKing->getPosition();
+void Board::putPiece(pieceTypeWithColor piece, int square) {
+    clearSquare(square);
+    Bitboard b = squareBB(square);
+    byType[static_cast<int>(typeOf(piece))] |= b;
+    byColor[static_cast<int>(colorOf(piece))] |= b;
+    mailbox[square] = piece;
+    key ^= Zobrist::pieceSquare[static_cast<int>(piece)][square];
+}
 
-    // Check if any opponent's piece can move to the king's position
-    std::vector<std::shared_ptr<Piece>> opponentPieces = (color == Color::WHITE) ? blackPieces : whitePieces;
-    for (std::shared_ptr<Piece> piece : opponentPieces) {
-        // std::cout << "checking piece: " << *piece << std::endl;
-        if (piece->isValidMove(*this, piece->getPosition(), kingPos)) {
-            return true;
+void Board::clearSquare(int square) {
+    pieceTypeWithColor piece = mailbox[square];
+    if (piece == pieceTypeWithColor::empty) {
+        return;
+    }
+    Bitboard b = squareBB(square);
+    byType[static_cast<int>(typeOf(piece))] &= ~b;
+    byColor[static_cast<int>(colorOf(piece))] &= ~b;
+    mailbox[square] = pieceTypeWithColor::empty;
+    key ^= Zobrist::pieceSquare[static_cast<int>(piece)][square];
+}
+
+Bitboard Board::attackersTo(int square, Bitboard occupied) const {
+    return (pawnAttacks[static_cast<int>(Color::WHITE)][square] & pieces(Color::BLACK, PieceType::PAWN))
+         | (pawnAttacks[static_cast<int>(Color::BLACK)][square] & pieces(Color::WHITE, PieceType::PAWN))
+         | (knightAttacks[square] & byType[static_cast<int>(PieceType::KNIGHT)])
+         | (kingAttacks[square] & byType[static_cast<int>(PieceType::KING)])
+         | (bishopAttacks(square, occupied) & (byType[static_cast<int>(PieceType::BISHOP)] | byType[static_cast<int>(PieceType::QUEEN)]))
+         | (rookAttacks(square, occupied) & (byType[static_cast<int>(PieceType::ROOK)] | byType[static_cast<int>(PieceType::QUEEN)]));
+}
+
+bool Board::isLegal(int from, int to, int captureSquare) const {
+    pieceTypeWithColor piece = mailbox[from];
+    Color us = colorOf(piece);
+    int king = typeOf(piece) == PieceType::KING ? to : kingSquare(us);
+    if (king < 0) {
+        return true;
+    }
+    Bitboard occupiedAfter = (occupied() ^ squareBB(from)) | squareBB(to);
+    Bitboard enemies = byColor[static_cast<int>(us) ^ 1];
+    if (captureSquare >= 0) {
+        occupiedAfter &= ~squareBB(captureSquare);
+        occupiedAfter |= squareBB(to);
+        enemies &= ~squareBB(captureSquare);
+    }
+    return !(attackersTo(king, occupiedAfter) & enemies);
+}
+
+bool Board::isSquareAttacked(int square, Color attacker) const {
+    if (trackAttacks) {
+        return attackMap[static_cast<int>(attacker)] & squareBB(square);
+    }
+    const int them = static_cast<int>(attacker);
+    const Bitboard attackers = byColor[them];
+    const Bitboard occ = occupied();
+    return (pawnAttacks[them ^ 1][square] & byType[static_cast<int>(PieceType::PAWN)] & attackers)
+        || (knightAttacks[square] & byType[static_cast<int>(PieceType::KNIGHT)] & attackers)
+        || (kingAttacks[square] & byType[static_cast<int>(PieceType::KING)] & attackers)
+        || (bishopAttacks(square, occ) & (byType[static_cast<int>(PieceType::BISHOP)] | byType[static_cast<int>(PieceType::QUEEN)]) & attackers)
+        || (rookAttacks(square, occ) & (byType[static_cast<int>(PieceType::ROOK)] | byType[static_cast<int>(PieceType::QUEEN)]) & attackers);
+}
+
+Bitboard Board::attackedSquares(Color attacker) const {
+    if (trackAttacks) {
+        return attackMap[static_cast<int>(attacker)];
+    }
+    const Bitboard occ = occupied();
+    const Bitboard pawns = pieces(attacker, PieceType::PAWN);
+    Bitboard attacks = attacker == Color::WHITE
+        ? ((pawns << 7) & ~FileH) | ((pawns << 9) & ~FileA)
+        : ((pawns >> 9) & ~FileH) | ((pawns >> 7) & ~FileA);
+    for (Bitboard b = byColor[static_cast<int>(attacker)] & ~pawns; b; ) {
+        int square = popLsb(b);
+        switch (typeOf(mailbox[square])) {
+            case PieceType::KNIGHT: attacks |= knightAttacks[square]; break;
+            case PieceType::BISHOP: attacks |= bishopAttacks(square, occ); break;
+            case PieceType::ROOK:   attacks |= rookAttacks(square, occ); break;
+            case PieceType::QUEEN:  attacks |= queenAttacks(square, occ); break;
+            default:                attacks |= kingAttacks[square]; break;
         }
     }
-    return false;
+    return attacks;
+}
+
+void Board::setAttackTracking(bool enabled) {
+    trackAttacks = false;
+    if (enabled) {
+        refreshAttackMaps();
+        trackAttacks = true;
+    }
+}
+
+void Board::refreshAttackMaps() {
+    updateAttackMaps(~0ULL);
+}
+
+Bitboard Board::pieceAttacks(int square, Bitboard occupied) const {
+    const pieceTypeWithColor piece = mailbox[square];
+    switch (typeOf(piece)) {
+        case PieceType::PAWN:   return pawnAttacks[static_cast<int>(colorOf(piece))][square];
+        case PieceType::KNIGHT: return knightAttacks[square];
+        case PieceType::BISHOP: return bishopAttacks(square, occupied);
+        case PieceType::ROOK:   return rookAttacks(square, occupied);
+        case PieceType::QUEEN:  return queenAttacks(square, occupied);
+        default:                return kingAttacks[square];
+    }
+}
+
+void Board::updateAttackMaps(Bitboard changed) {
+    const Bitboard occ = occupied();
+    // A slider's attacks only depend on the squares up to its first blocker, which are all in
+    // its old attack set; if none of those changed, neither did its attacks
+    Bitboard stale = changed;
+    const Bitboard sliders = (byType[static_cast<int>(PieceType::BISHOP)] | byType[static_cast<int>(PieceType::ROOK)]
+                            | byType[static_cast<int>(PieceType::QUEEN)]) & ~changed;
+    for (Bitboard b = sliders; b; ) {
+        const int square = popLsb(b);
+        if (attacksFrom[square] & changed) {
+            stale |= squareBB(square);
+        }
+    }
+    for (Bitboard b = stale; b; ) {
+        const int square = popLsb(b);
+        attacksFrom[square] = mailbox[square] == pieceTypeWithColor::empty ? 0 : pieceAttacks(square, occ);
+    }
+    // the union can't be patched (another piece may cover the same square), but folding the
+    // stored sets is a handful of ORs with no attack generation
+    for (int color = 0; color < 2; ++color) {
+        attackMap[color] = 0;
+        for (Bitboard b = byColor[color]; b; ) {
+            attackMap[color] |= attacksFrom[popLsb(b)];
+        }
+    }
+}
+
+// Check if a move puts the player in check
+bool Board::isCheck(Color color) const {
+    int king = kingSquare(color);
+    if (king < 0) {
+        return false;
+    }
+    return isSquareAttacked(king, color == Color::WHITE ? Color::BLACK : Color::WHITE);
 }
 
 // Check if the current player is in checkmate
@@ -329,20 +813,170 @@ Color Board::getSideToMove() const {
 // Switch the side to move
 void Board::switchSideToMove() {
     sideToMove = (sideToMove == Color::WHITE) ? Color::BLACK : Color::WHITE;
+    key ^= Zobrist::side;
 }
 
 bool Board::isValidPosition(Position pos) const {
     return pos.row >= 0 && pos.row < 8 && pos.col >= 0 && pos.col < 8;
 }
 
+Board::CheckInfo Board::checkInfo(Color color) const {
+    CheckInfo info{kingSquare(color), 0, ~0ULL, 0};
+    if (info.kingSquare < 0) {
+        return info;
+    }
+    const int king = info.kingSquare;
+    const Bitboard own = byColor[static_cast<int>(color)];
+    const Bitboard enemies = byColor[static_cast<int>(color) ^ 1];
+    const Bitboard occ = own | enemies;
+
+    if (!trackAttacks || (attackMap[static_cast<int>(color) ^ 1] & squareBB(king))) {
+        info.checkers = attackersTo(king, occ) & enemies;
+    }
+    if (info.checkers) {
+        // a double check can only be answered by a king move
+        info.checkMask = (info.checkers & (info.checkers - 1)) ? 0
+                       : betweenBB[king][lsb(info.checkers)] | info.checkers;
+    }
+
+    // an own piece alone between the king and an enemy slider on the same line is pinned
+    Bitboard snipers = ((rookAttacks(king, 0) & (byType[static_cast<int>(PieceType::ROOK)] | byType[static_cast<int>(PieceType::QUEEN)]))
+                      | (bishopAttacks(king, 0) & (byType[static_cast<int>(PieceType::BISHOP)] | byType[static_cast<int>(PieceType::QUEEN)])))
+                     & enemies;
+    while (snipers) {
+        Bitboard blockers = betweenBB[king][popLsb(snipers)] & occ;
+        if (blockers && !(blockers & (blockers - 1)) && (blockers & own)) {
+            info.pinned |= blockers;
+        }
+    }
+    return info;
+}
+
+template <typename Emit>
+void Board::generateLegalMoves(Color color, Bitboard fromMask, Emit&& emit) const {
+    const CheckInfo info = checkInfo(color);
+    const int us = static_cast<int>(color);
+    const int king = info.kingSquare;
+    const Bitboard own = byColor[us];
+    const Bitboard enemies = byColor[us ^ 1];
+    const Bitboard occ = own | enemies;
+
+    // Where the piece on `from` may land: on the check mask, and on the pin line if pinned
+    auto allowed = [&](int from) {
+        return (info.pinned & squareBB(from)) ? info.checkMask & lineBB[king][from] : info.checkMask;
+    };
+
+    // King: the destination must not be attacked once the king has left its square
+    if (king >= 0 && (fromMask & squareBB(king))) {
+        const Bitboard occWithoutKing = occ ^ squareBB(king);
+        for (Bitboard targets = kingAttacks[king] & ~own; targets; ) {
+            int to = popLsb(targets);
+            if (!(attackersTo(to, occWithoutKing) & enemies)) {
+                emit(king, to, (enemies & squareBB(to)) ? to : -1, false);
+            }
+        }
+
+        // Castling: the king may not start in, pass through or land in check
+        const uint8_t rights = castlingRights & (color == Color::WHITE ? (WHITE_OO | WHITE_OOO) : (BLACK_OO | BLACK_OOO));
+        if (rights && !info.checkers && king == (color == Color::WHITE ? 4 : 60)) {
+            auto safe = [&](int square) { return !isSquareAttacked(square, color == Color::WHITE ? Color::BLACK : Color::WHITE); };
+            const pieceTypeWithColor rook = makePiece(PieceType::ROOK, color);
+            if ((rights & (WHITE_OO | BLACK_OO)) && mailbox[king + 3] == rook
+                && !(occ & betweenBB[king][king + 3]) && safe(king + 1) && safe(king + 2)) {
+                emit(king, king + 2, -1, true);
+            }
+            if ((rights & (WHITE_OOO | BLACK_OOO)) && mailbox[king - 4] == rook
+                && !(occ & betweenBB[king][king - 4]) && safe(king - 1) && safe(king - 2)) {
+                emit(king, king - 2, -1, true);
+            }
+        }
+    }
+    if (!info.checkMask) {
+        return;
+    }
+
+    // Pawns: pushes, captures and en passant
+    const int forward = color == Color::WHITE ? 8 : -8;
+    const int startRow = color == Color::WHITE ? 1 : 6;
+    for (Bitboard b = pieces(color, PieceType::PAWN) & fromMask; b; ) {
+        int from = popLsb(b);
+        Bitboard mask = allowed(from);
+        int to = from + forward;
+        if (!(occ & squareBB(to))) {
+            if (mask & squareBB(to)) {
+                emit(from, to, -1, false);
+            }
+            if (from / 8 == startRow && !(occ & squareBB(to + forward)) && (mask & squareBB(to + forward))) {
+                emit(from, to + forward, -1, false);
+            }
+        }
+        for (Bitboard targets = pawnAttacks[us][from] & enemies & mask; targets; ) {
+            int target = popLsb(targets);
+            emit(from, target, target, false);
+        }
+        // en passant can expose the king along the rank, so it gets the full check
+        if (color == sideToMove && epSquare >= 0 && (pawnAttacks[us][from] & squareBB(epSquare))
+            && isLegal(from, epSquare, epSquare - forward)) {
+            emit(from, epSquare, epSquare - forward, false);
+        }
+    }
+
+    // Knights and sliders
+    const Bitboard others = own & ~byType[static_cast<int>(PieceType::PAWN)] & ~byType[static_cast<int>(PieceType::KING)];
+    for (Bitboard b = others & fromMask; b; ) {
+        int from = popLsb(b);
+        Bitboard targets;
+        switch (typeOf(mailbox[from])) {
+            case PieceType::KNIGHT: targets = knightAttacks[from]; break;
+            case PieceType::BISHOP: targets = bishopAttacks(from, occ); break;
+            case PieceType::ROOK:   targets = rookAttacks(from, occ); break;
+            default:                targets = queenAttacks(from, occ); break;
+        }
+        for (targets &= ~own & allowed(from); targets; ) {
+            int to = popLsb(targets);
+            emit(from, to, (enemies & squareBB(to)) ? to : -1, false);
+        }
+    }
+}
+
+void Board::generateLegalMoves(Color color, MoveList& moveList) const {
+    moveList.clear();
+    generateLegalMoves(color, ~0ULL, [&](int from, int to, int captureSquare, bool castling) {
+        if (castling) {
+            moveList.push(PackedMove(from, to, PackedMove::CASTLING));
+        } else if (typeOf(mailbox[from]) == PieceType::PAWN && (to / 8 == 0 || to / 8 == 7)) {
+            for (PieceType promotion : promotionTypes) {
+                moveList.push(PackedMove(from, to, PackedMove::PROMOTION, promotion));
+            }
+        } else {
+            moveList.push(PackedMove(from, to, captureSquare >= 0 && captureSquare != to ? PackedMove::EN_PASSANT : PackedMove::NORMAL));
+        }
+    });
+}
+
+Bitboard Board::legalTargets(int from) const {
+    Bitboard targets = 0;
+    if (mailbox[from] != pieceTypeWithColor::empty) {
+        generateLegalMoves(colorOf(mailbox[from]), squareBB(from), [&](int, int to, int, bool) {
+            targets |= squareBB(to);
+        });
+    }
+    return targets;
+}
+
 std::vector<Move> Board::generateAllPossibleMoves(Color color) const {
-    auto pieces = color == Color::WHITE ? whitePieces : blackPieces;
     std::vector<Move> allMoves;
-    for (std::shared_ptr<Piece> piece : pieces) {
-        std::vector<Position> possibleMoves = piece->generatePossibleMoves(*this);
-        for (const Position& pos : possibleMoves) {
-            allMoves.emplace_back(piece->getPosition(), pos, piece, getPiece(pos));
+    allMoves.reserve(64);
+    generateLegalMoves(color, ~0ULL, [&](int from, int to, int captureSquare, bool castling) {
+        std::shared_ptr<Piece> piece = getPiece(Position(from));
+        std::shared_ptr<Piece> captured = captureSquare >= 0 ? getPiece(Position(captureSquare)) : nullptr;
+        if (typeOf(mailbox[from]) == PieceType::PAWN && (to / 8 == 0 || to / 8 == 7)) {
+            for (PieceType promotion : promotionTypes) {
+                allMoves.emplace_back(Position(from), Position(to), piece, captured, false, true, nullptr, promotion);
+            }
+        } else {
+            allMoves.emplace_back(Position(from), Position(to), piece, captured, castling);
         }
-    }
+    });
     return allMoves;
 }
@@ -2,16 +2,61 @@
 
 #include "Game.h"
 #include <stdio.h>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
 #include "Utility.h"
 
-Game::Game(): selectedPiece(nullptr), stockfish("C:\\Users\\simon\\Documents\\Chess\\external\\Stockfish\\build\\bin\\stockfish.exe")
+std::unique_ptr<EngineBackend> Game::createEngine() {
+    return std::make_unique<EngineBackend>(defaultEngineLocation());
+}
+
+static uint64_t nextGameId() {
+    static std::atomic<uint64_t> counter{0};
+    return ++counter;
+}
+
+std::shared_ptr<AnalysisCache> Game::createAnalysisCache() {
+    const char* path = std::getenv("CHESS_ANALYSIS_CACHE");
+    return std::make_shared<AnalysisCache>(4096, path ? path : "analysis.cache");
+}
+
+std::shared_ptr<PolyglotBook> Game::createOpeningBook() {
+    const char* path = std::getenv("CHESS_BOOK");
+    auto book = std::make_shared<PolyglotBook>(path ? path : "book.bin");
+    return book->isOpen() ? book : nullptr;
+}
+
+TimeControl Game::createTimeControl() {
+    const char* text = std::getenv("CHESS_TIME_CONTROL");
+    TimeControl control;
+    if (!TimeControl::parse(text ? text : "-", control)) {
+        std::cout << "can't read time control " << text << ", playing untimed" << std::endl;
+    }
+    return control;
+}
+
+Game::Game(): Game(std::make_shared<EnginePoolType>(1, &Game::createEngine), createAnalysisCache(), createOpeningBook())
+{
+}
+
+Game::Game(std::shared_ptr<EnginePoolType> engines, std::shared_ptr<AnalysisCache> analysisCache,
+           std::shared_ptr<PolyglotBook> book)
+    : engines(std::move(engines)), analysisCache(std::move(analysisCache)), book(std::move(book)),
+      gameId(nextGameId()), selectedPiece(nullptr), clock(createTimeControl())
 {
     board.initialize();
+    // the game asks for check status after every move
+    board.setAttackTracking(true);
     std::cout << "Game constructor" << std::endl;
 }
 
 Game::~Game() {
-
+    if (ponderingEngine) {
+        ponderingEngine->stopPondering();
+        ponderingEngine.release();
+    }
+    engines->endGame(gameId);
 }
 
 std::string Game::boardToFEN() {
@@ -65,16 +110,72 @@ void Game::processInput(int input) {
 }
 void Game::startGame() {
     std::cout << "welcome to Simon's Chess Game" << std::endl;
+    if (!clock.isRunning()) {
+        clock.start(board.getSideToMove());
+    }
+    const bool timed = clock.getControl().isTimed();
     while (!isGameOver()) {
         auto colorString = board.getSideToMove() == Color::WHITE ? "white" : "black";
         std::cout << colorString << "'s turn" << std::endl;
+        if (timed) {
+            std::cout << "white " << GameClock::format(clock.remainingMs(Color::WHITE))
+                      << ", black " << GameClock::format(clock.remainingMs(Color::BLACK)) << std::endl;
+        }
         printBoard();
         bool successfulMove = false;
         while (!successfulMove) {
             if (board.getSideToMove() == Color::BLACK) { // Assuming AI plays black
                 std::string fen = board.toFEN(); // Convert the current board state to FEN
                 std::cout << "fen: " << fen << std::endl;
-                std::string bestMove = stockfish.getBestMoveTimed(fen, 1000);
+                const Color side = board.getSideToMove();
+                const SearchLimits limits = timed ? clock.searchLimits(side) : SearchLimits::forTime(1000);
+                // on a clock the cache is asked for a search as long as a typical move gets
+                const SearchLimits cacheLimits = timed
+                    ? SearchLimits::forTime(static_cast<int>(clock.typicalMoveTimeMs(side))) : limits;
+                std::vector<std::string> moves = board.uciMoves();
+                Analysis analysis;
+                const int ply = 2 * (board.fullmoveNumber - 1) + (board.getSideToMove() == Color::BLACK ? 1 : 0);
+                std::string bookMove;
+                if (book && ply < maxBookPlies) {
+                    bookMove = book->probe(board, bookSelection);
+                }
+                bool searched = false;
+                // the engine that pondered has the game's state
+                EnginePoolType::Lease engine = std::move(ponderingEngine);
+                if (!bookMove.empty()) {
+                    std::cout << "book move" << std::endl;
+                    analysis.bestMove = bookMove;
+                    if (engine) {
+                        engine->stopPondering();
+                    }
+                } else if (engine && engine->isPondering() && !moves.empty() && moves.back() == predictedMove) {
+                    std::cout << "ponder hit" << std::endl;
+                    analysis = engine->ponderHit();
+                    searched = true;
+                } else if (analysisCache && analysisCache->lookup(fen, cacheLimits, analysis)) {
+                    std::cout << "found in the analysis cache" << std::endl;
+                    if (engine) {
+                        engine->stopPondering();
+                    }
+                } else {
+                    if (!engine) {
+                        engine = engines->checkout(gameId);
+                    }
+                    if (engine) {
+                        analysis = engine->analyze(board.getRootFEN(), moves, limits);
+                        searched = true;
+                    } else {
+                        // the pool turned the request away (its queue is full); wait before
+                        // asking again rather than spinning on checkout
+                        std::cout << "no engine available, retrying in a second" << std::endl;
+                        std::this_thread::sleep_for(std::chrono::seconds(1));
+                    }
+                }
+                if (analysisCache && searched) {
+                    // a search on a clock is filed under the time it actually took
+                    analysisCache->store(fen, timed ? SearchLimits::forTime(analysis.timeMs) : limits, analysis);
+                }
+                const std::string& bestMove = analysis.bestMove;
                 std::cout << "Stockfish suggests: " << bestMove << std::endl;
                 if (!bestMove.empty()) {
                     std::cout << bestMove.substr(0, 2) << " to " << bestMove.substr(2, 2) << std::endl;
@@ -82,11 +183,29 @@ void Game::startGame() {
                     to = Position(bestMove.substr(2, 2));
                     std::cout << "moving from " << from << " to " << to << std::endl;
                     selectedPiece = board.getPiece(from);
-                    auto legalMoves = selectedPiece->generatePossibleMoves(board);
-                    if (selectedPiece && selectedPiece->getColor() == board.getSideToMove() && selectedPiece->isValidMove(board, from, to)) {
-                    // if (true) {
-                        board.movePiece(from, to);
+                    // e.g. "e7e8n": the fifth character is the promotion piece
+                    PieceType promotion = PieceType::QUEEN;
+                    if (bestMove.size() > 4) {
+                        switch (bestMove[4]) {
+                            case 'r': promotion = PieceType::ROOK; break;
+                            case 'b': promotion = PieceType::BISHOP; break;
+                            case 'n': promotion = PieceType::KNIGHT; break;
+                            default: break;
+                        }
+                    }
+                    // the engine's move may be castling or en passant, which isValidMove doesn't know
+                    if (selectedPiece && selectedPiece->getColor() == board.getSideToMove()
+                        && (board.legalTargets(from.index()) & Bitboards::squareBB(to.index()))) {
+                        board.movePiece(from, to, true, promotion);
+                        clock.press();
                         successfulMove = true;
+                        // think on the player's time about the reply the engine expects
+                        predictedMove = analysis.ponderMove;
+                        if (ponder && engine && !predictedMove.empty()) {
+                            engine->startPondering(board.getRootFEN(), board.uciMoves(), predictedMove,
+                                                   timed ? clock.searchLimits(side) : SearchLimits::forTime(1000));
+                            ponderingEngine = std::move(engine);
+                        }
                         break;
                     } else {
                         std::cout << "invalid move from " << from << " to " << to << ". please try again. " << std::endl;
@@ -100,7 +219,8 @@ void Game::startGame() {
                 }
                 std::cout << "starting position is " << from << std::endl;
                 std::cout << "Ok, that's a valid piece. Now tell me where. ";
-                auto legalMoves = selectedPiece->generatePossibleMoves(board);
+                std::vector<Position> legalMoves;
+                selectedPiece->generateMoves(board, legalMoves);
                 std::cout << "here are all the possible moves you could make: \n" << std::endl;
                 for (auto pos : legalMoves) {
                     std::cout << pos << ", ";
@@ -113,8 +233,11 @@ void Game::startGame() {
                 std::cout << "destination position is " << to << std::endl;
                 startGrid = -1;
                 destGrid = -1;
-                if (selectedPiece && selectedPiece->getColor() == board.getSideToMove() && selectedPiece->isValidMove(board, from, to)) {
+                // checked against the same legal targets listed above, castling and en passant included
+                if (selectedPiece && selectedPiece->getColor() == board.getSideToMove()
+                    && (board.legalTargets(from.index()) & Bitboards::squareBB(to.index()))) {
                     board.movePiece(from, to);
+                    clock.press();
                     successfulMove = true;
                     // Additional logic like checking for check or checkmate can be added here
                     break;
@@ -132,7 +255,17 @@ void Game::switchPlayer() {
 
 }
 bool Game::isGameOver() {
-  return false;
+    for (Color side : { Color::WHITE, Color::BLACK }) {
+        if (clock.isFlagged(side)) {
+            std::cout << (side == Color::WHITE ? "white" : "black") << " lost on time." << std::endl;
+            return true;
+        }
+    }
+    if (board.isThreefoldRepetition()) {
+        std::cout << "draw by threefold repetition." << std::endl;
+        return true;
+    }
+    return false;
 }
 void Game::processMove(Move move) {
     
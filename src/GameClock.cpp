@@ -0,0 +1,189 @@
+#include "GameClock.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+// Whole non-negative number; false if `text` is anything else
+bool parseNumber(const std::string& text, long long& value) {
+    if (text.empty() || text.size() > 12 || text.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    value = std::atoll(text.c_str());
+    return true;
+}
+
+int index(Color color) {
+    return static_cast<int>(color);
+}
+
+Color opponent(Color color) {
+    return color == Color::WHITE ? Color::BLACK : Color::WHITE;
+}
+
+} // namespace
+
+bool TimeControl::parse(const std::string& text, TimeControl& control) {
+    control = TimeControl();
+    if (text == "-") {
+        return true;
+    }
+
+    std::string rest = text;
+    size_t slash = rest.find('/');
+    if (slash != std::string::npos) {
+        long long moves;
+        if (!parseNumber(rest.substr(0, slash), moves) || moves == 0 || moves > 1000) {
+            return false;
+        }
+        control.movesPerPeriod = static_cast<int>(moves);
+        rest = rest.substr(slash + 1);
+    }
+    // the base may be followed by an increment (+), a simple delay (d) or a Bronstein delay (b)
+    size_t extra = rest.find_first_of("+db");
+    long long seconds;
+    if (!parseNumber(rest.substr(0, extra), seconds) || seconds == 0) {
+        return false;
+    }
+    control.baseMs = seconds * 1000;
+    if (extra != std::string::npos) {
+        long long extraSeconds;
+        if (!parseNumber(rest.substr(extra + 1), extraSeconds)) {
+            return false;
+        }
+        if (rest[extra] == '+') {
+            control.incrementMs = extraSeconds * 1000;
+        } else {
+            control.delayMs = extraSeconds * 1000;
+            control.delay = rest[extra] == 'd' ? TimeControl::Delay::SIMPLE : TimeControl::Delay::BRONSTEIN;
+        }
+    }
+    return true;
+}
+
+GameClock::GameClock(const TimeControl& control) {
+    reset(control);
+}
+
+void GameClock::reset(const TimeControl& newControl) {
+    control = newControl;
+    for (int side = 0; side < 2; ++side) {
+        remaining[side] = control.baseMs;
+        movesMade[side] = 0;
+        flagged[side] = false;
+    }
+    running = false;
+    turn = Color::WHITE;
+}
+
+void GameClock::start(Color side) {
+    turn = side;
+    running = true;
+    moveStart = Clock::now();
+}
+
+long long GameClock::elapsedMs() const {
+    if (!running) {
+        return 0;
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - moveStart).count();
+}
+
+long long GameClock::chargeFor(long long elapsed) const {
+    if (control.delay == TimeControl::Delay::SIMPLE) {
+        return std::max(0LL, elapsed - control.delayMs);
+    }
+    // a Bronstein delay is only given back once the move is made
+    return elapsed;
+}
+
+bool GameClock::press() {
+    if (!running) {
+        return !isFlagged(turn);
+    }
+    const long long elapsed = elapsedMs();
+    const int side = index(turn);
+    if (control.isTimed() && !flagged[side]) {
+        remaining[side] -= chargeFor(elapsed);
+        if (remaining[side] <= 0) {
+            remaining[side] = 0;
+            flagged[side] = true;
+        } else {
+            if (control.delay == TimeControl::Delay::BRONSTEIN) {
+                remaining[side] += std::min(elapsed, control.delayMs);
+            }
+            remaining[side] += control.incrementMs;
+            ++movesMade[side];
+            if (control.movesPerPeriod > 0 && movesMade[side] % control.movesPerPeriod == 0) {
+                remaining[side] += control.baseMs;
+            }
+        }
+    }
+    const bool inTime = !flagged[side];
+    start(opponent(turn));
+    return inTime;
+}
+
+void GameClock::stop() {
+    if (!running) {
+        return;
+    }
+    const int side = index(turn);
+    if (control.isTimed() && !flagged[side]) {
+        remaining[side] = std::max(0LL, remaining[side] - chargeFor(elapsedMs()));
+        flagged[side] = remaining[side] == 0;
+    }
+    running = false;
+}
+
+long long GameClock::remainingMs(Color side) const {
+    long long left = remaining[index(side)];
+    if (running && side == turn) {
+        left -= chargeFor(elapsedMs());
+    }
+    return std::max(0LL, left);
+}
+
+bool GameClock::isFlagged(Color side) const {
+    if (!control.isTimed()) {
+        return false;
+    }
+    return flagged[index(side)] || (running && side == turn && remainingMs(side) == 0);
+}
+
+int GameClock::movesToGo(Color side) const {
+    if (control.movesPerPeriod <= 0) {
+        return 0;
+    }
+    return control.movesPerPeriod - movesMade[index(side)] % control.movesPerPeriod;
+}
+
+SearchLimits GameClock::searchLimits(Color side) const {
+    SearchLimits limits;
+    if (!control.isTimed()) {
+        return limits;
+    }
+    // a flagged clock reads 0, which would read as "no clock"; 1 ms keeps the search short
+    limits.whiteTimeMs = std::max(1LL, remainingMs(Color::WHITE));
+    limits.blackTimeMs = std::max(1LL, remainingMs(Color::BLACK));
+    limits.whiteIncMs = limits.blackIncMs = control.incrementMs + control.delayMs;
+    limits.movesToGo = movesToGo(side);
+    return limits;
+}
+
+long long GameClock::typicalMoveTimeMs(Color side) const {
+    if (!control.isTimed()) {
+        return 0;
+    }
+    // a game is taken to last another 40 moves when no time control says otherwise
+    const int moves = control.movesPerPeriod > 0 ? movesToGo(side) : 40;
+    return remainingMs(side) / moves + control.incrementMs + control.delayMs;
+}
+
+std::string GameClock::format(long long ms) {
+    char text[32];
+    const long long tenths = ms / 100;
+    std::snprintf(text, sizeof(text), "%lld:%02lld.%lld", tenths / 600, tenths / 10 % 60, tenths % 10);
+    return text;
+}
@@ -0,0 +1,165 @@
+#include "MappedFile.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::openReadOnly(const std::string& path) {
+    close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    // an empty file can't be mapped
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE section = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (section == NULL) {
+        return false;
+    }
+    // the view keeps the file open
+    mapping = MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(section);
+    if (mapping == NULL) {
+        mapping = nullptr;
+        return false;
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+    writable = false;
+    return true;
+}
+
+bool MappedFile::openReadWrite(const std::string& path, size_t size) {
+    close();
+    if (size == 0) {
+        return false;
+    }
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+    // a mapping larger than the file grows the file
+    unsigned long long mapSize = std::max<unsigned long long>(size, static_cast<unsigned long long>(fileSize.QuadPart));
+    HANDLE section = CreateFileMappingA(file, NULL, PAGE_READWRITE, static_cast<DWORD>(mapSize >> 32),
+                                        static_cast<DWORD>(mapSize), NULL);
+    CloseHandle(file);
+    if (section == NULL) {
+        return false;
+    }
+    mapping = MapViewOfFile(section, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    CloseHandle(section);
+    if (mapping == NULL) {
+        mapping = nullptr;
+        return false;
+    }
+    length = size;
+    writable = true;
+    return true;
+}
+
+void MappedFile::flush() {
+    if (mapping && writable) {
+        FlushViewOfFile(mapping, 0);
+    }
+}
+
+void MappedFile::close() {
+    if (mapping) {
+        flush();
+        UnmapViewOfFile(mapping);
+        mapping = nullptr;
+        length = 0;
+    }
+}
+
+#else
+
+bool MappedFile::openReadOnly(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    // an empty file can't be mapped
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps the file open
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        return false;
+    }
+    mapping = address;
+    length = static_cast<size_t>(info.st_size);
+    writable = false;
+    return true;
+}
+
+bool MappedFile::openReadWrite(const std::string& path, size_t size) {
+    close();
+    if (size == 0) {
+        return false;
+    }
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (static_cast<size_t>(info.st_size) < size && ftruncate(fd, static_cast<off_t>(size)) != 0)) {
+        ::close(fd);
+        return false;
+    }
+    void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        return false;
+    }
+    mapping = address;
+    length = size;
+    writable = true;
+    return true;
+}
+
+void MappedFile::flush() {
+    if (mapping && writable) {
+        msync(mapping, length, MS_SYNC);
+    }
+}
+
+void MappedFile::close() {
+    if (mapping) {
+        // written pages reach the file even without a flush; munmap doesn't discard them
+        munmap(mapping, length);
+        mapping = nullptr;
+        length = 0;
+    }
+}
+
+#endif
@@ -15,47 +15,38 @@ std::ostream& operator<<(std::ostream& os, const Piece& piece) {
     return os;
 }
 
-std::vector<Position> Piece::filterCheckMoves(const Board& board, std::vector<Position>& moves) {
-    // std::cout << "filterCheckMoves: filtering check moves" << std::endl;
-    // Filter out moves that would leave the king in check
+void Piece::generateMoves(const Board& board, std::vector<Position>& out) const {
+    // The board's legal generator covers every piece type, castling and en passant included
+    for (Bitboard targets = board.legalTargets(position.index()); targets; ) {
+        out.push_back(Position(Bitboards::popLsb(targets)));
+    }
+}
+
+std::vector<Position>& Piece::generatePossibleMoves(const Board& board) {
+    moves.clear();
+    generateMoves(board, moves);
+    return moves;
+}
+
+std::vector<Position> Piece::filterCheckMoves(const Board& board, const std::vector<Position>& moves) const {
+    // Filter out moves that would leave the king in check. The board works out pins and
+    // checks once for this piece instead of playing every move, so it is never modified.
+    Bitboard legal = board.legalTargets(position.index());
     std::vector<Position> filteredMoves;
-    Color currentColor = color;
-    std::cout << "filterCheckMoves: moves before filtering: " << moves.size() << std::endl;
     for (auto move : moves) {
-        //const cast board
-        Board& boardRef = const_cast<Board&>(board);
-        if(!boardRef.movePiece(position, move, false)) {
-            std::cout << "filterCheckMoves: move failed" << std::endl;
-            continue;
-        }
-        if (!boardRef.isCheck(currentColor)) {
-            std::cout << "filterCheckMoves: move valid. color: " << currentColor << std::endl;
+        if (legal & Bitboards::squareBB(move.index())) {
             filteredMoves.push_back(move);
-        } else {
-            std::cout << "filterCheckMoves: filtered move: " << move << std::endl;
         }
-        boardRef.undoMove();
     }
-    std::cout << "filterCheckMoves: valid moves after filtering: " << filteredMoves.size() << std::endl;
     return filteredMoves;
 }
 
 // Implementation of King methods
 King::King(Color color, Position pos) : Piece(PieceType::KING, color, pos) {}
 
-bool King::isCastling(Position to) {
-    if(hasMoved) {
-        std::cout << "King::isCastling: king has moved, return false" << std::endl;
-        return false;
-    }
-    if (castlingMoves.empty()) {
-        std::cout << "King::isCastling: castlingMoves is empty, return false" << std::endl;
-        return false;
-    }
-    if (std::find(castlingMoves.begin(), castlingMoves.end(), to) != castlingMoves.end()) {
-        return true;
-    }
-    return false;
+bool King::isCastling(Position to) const {
+    // castling is the only way a king moves two files
+    return to.row == position.row && std::abs(to.col - position.col) == 2;
 }
 
 bool King::isValidMove(const Board& board, Position from, Position to) const {
@@ -81,108 +72,17 @@ std::string King::getPieceType() const {
     return "King";
 }
 
-std::vector<Position>& King::generatePossibleMoves(const Board& board) {
-    moves.clear();
-    for (int rowDiff = -1; rowDiff <= 1; ++rowDiff) {
-        for (int colDiff = -1; colDiff <= 1; ++colDiff) {
-            if (rowDiff != 0 || colDiff != 0) {
-                Position newPos(position.row + rowDiff, position.col + colDiff);
-                if (board.isValidPosition(newPos)) {
-                    std::shared_ptr<Piece> pieceAtNewPos = board.getPiece(newPos);
-                    if (pieceAtNewPos == nullptr || pieceAtNewPos->getColor() != color) {
-                        moves.push_back(newPos);
-                    }
-                }
-            }
-        }
-    }
-
-    // add castling moves
-    bool castlingValid = false; 
-    if (!hasMoved && !board.getIsInCheck()) {
-        // Castling
-        if (color == Color::WHITE) {
-            if (board.getPiece({0, 5}) == nullptr && board.getPiece({0, 6}) == nullptr) {
-                std::shared_ptr<Piece> rook = board.getPiece({0, 7});
-                if (rook != nullptr && rook->getType() == PieceType::ROOK && rook->getColor() == Color::WHITE && !rook->hasMoved) {
-                    if (true) {
-                        moves.push_back({0, 6});
-                        castlingMoves.push_back({0, 6});
-                        castlingValid = true;
-                    }
-                }
-            }
-            if (board.getPiece({0, 3}) == nullptr && board.getPiece({0, 2}) == nullptr && board.getPiece({0, 1}) == nullptr) {
-                std::shared_ptr<Piece> rook = board.getPiece({0, 0});
-                if (rook != nullptr && rook->getType() == PieceType::ROOK && rook->getColor() == Color::WHITE && !rook->hasMoved) {
-                    if (true) {
-                        moves.push_back({0, 2});
-                        castlingMoves.push_back({0, 2});
-                        castlingValid = true;
-                    }
-                }
-            }
-        } else {
-            if (board.getPiece({7, 5}) == nullptr && board.getPiece({7, 6}) == nullptr) {
-                std::shared_ptr<Piece> rook = board.getPiece({7, 7});
-                if (rook != nullptr && rook->getType() == PieceType::ROOK && rook->getColor() == Color::BLACK && !rook->hasMoved) {
-                    if (true) {
-                        moves.push_back({7, 6});
-                        castlingMoves.push_back({7, 6});
-                        castlingValid = true;
-                    }
-                }
-            }
-            if (board.getPiece({7, 3}) == nullptr && board.getPiece({7, 2}) == nullptr && board.getPiece({7, 1}) == nullptr) {
-                std::shared_ptr<Piece> rook = board.getPiece({7, 0});
-                if (rook != nullptr && rook->getType() == PieceType::ROOK && rook->getColor() == Color::BLACK && !rook->hasMoved) {
-                    if (true) {
-                        moves.push_back({7, 2});
-                        castlingMoves.push_back({7, 2});
-                        castlingValid = true;
-                    }
-                }
-            }
-        }
-    }
-    std::cout << "castlingValid: " << castlingValid << std::endl;
-    if (!castlingValid) {
-        castlingMoves.clear();
-    }
-
-    if (true) {
-        moves = filterCheckMoves(board, moves);
-    }
-
-    return moves;
-}
-
 // Implementation of Queen methods
 Queen::Queen(Color color, Position pos) : Piece(PieceType::QUEEN, color, pos) {}
 
 bool Queen::isValidMove(const Board& board, Position from, Position to) const {
-    int rowDiff = std::abs(from.row - to.row);
-    int colDiff = std::abs(from.col - to.col);
-    // Check if move is in a straight line or diagonal
-    if (rowDiff != colDiff && rowDiff != 0 && colDiff != 0) {
+    // The destination must be reachable past any blockers...
+    if (!board.isValidPosition(from) || !board.isValidPosition(to)
+        || !(Bitboards::queenAttacks(from.index(), board.occupied()) & Bitboards::squareBB(to.index()))) {
         return false;
     }
-    // Determine step direction
-    int rowStep = (to.row - from.row) == 0 ? 0 : (to.row - from.row) / rowDiff;
-    int colStep = (to.col - from.col) == 0 ? 0 : (to.col - from.col) / colDiff;
-    // Check for obstacles
-    for (int i = 1; i < std::max(rowDiff, colDiff); ++i) {
-        Position intermediatePos = { from.row + i * rowStep, from.col + i * colStep };
-        if (board.getPiece(intermediatePos) != nullptr) {
-            return false;
-        }
-    }
-    // Ensure destination is either empty or contains an opponent's piece
-    std::shared_ptr<Piece> destinationPiece = board.getPiece(to);
-    if (destinationPiece == nullptr || destinationPiece->getColor() != color) {
-        return true;
-    }
-    return false;
+    // ...and either empty or contain an opponent's piece
+    return !(board.byColor[static_cast<int>(color)] & Bitboards::squareBB(to.index()));
 }
 
 char Queen::getSymbol() const {
@@ -193,73 +93,17 @@ std::string Queen::getPieceType() const {
     return "Queen";
 }
 
-std::vector<Position>& Queen::generatePossibleMoves(const Board& board) {
-    moves.clear();
-    // Directions: horizontal, vertical, and diagonal
-    static std::vector<std::pair<int, int>> directions = {
-        {1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {-1, -1}, {1, -1}, {-1, 1}
-    };
-    for (const auto& dir : directions) {
-        for (int i = 1; i < 8; ++i) {
-            Position newPos = { position.row + i * dir.first, position.col + i * dir.second };
-            if (!board.isValidPosition(newPos)) {
-                break;
-            }
-            std::shared_ptr<Piece> pieceAtNewPos = board.getPiece(newPos);
-            if (pieceAtNewPos == nullptr) {
-                moves.push_back(newPos);
-            } else {
-                if (pieceAtNewPos->getColor() != color) {
-                    moves.push_back(newPos);
-                }
-                break; // Stop if another piece is encountered
-            }
-        }
-    }
-
-    if (true) {
-        moves = filterCheckMoves(board, moves);
-    }
-
-    return moves;
-}
-
 // Implementation of Bishop methods
 Bishop::Bishop(Color color, Position pos) : Piece(PieceType::BISHOP, color, pos) {}
 
 bool Bishop::isValidMove(const Board& board, Position from, Position to) const {
-    int rowDiff = std::abs(from.row - to.row);
-    int colDiff = std::abs(from.col - to.col);
-
-    // Bishop moves diagonally
-    if (rowDiff != colDiff) {
-        return false;
-    }
-
-    // Check if rowDiff or colDiff is zero to prevent division by zero
-    if (rowDiff == 0 || colDiff == 0) {
+    // The destination must be reachable past any blockers...
+    if (!board.isValidPosition(from) || !board.isValidPosition(to)
+        || !(Bitboards::bishopAttacks(from.index(), board.occupied()) & Bitboards::squareBB(to.index()))) {
         return false;
     }
-
-    // Determine step direction
-    int rowStep = (to.row - from.row) / rowDiff;
-    int colStep = (to.col - from.col) / colDiff;
-
-    // Check for obstacles
-    for (int i = 1; i < rowDiff; ++i) {
-        Position intermediatePos = { from.row + i * rowStep, from.col + i * colStep };
-        if (board.getPiece(intermediatePos) != nullptr) {
-            return false;
-        }
-    }
-
-    // Ensure destination is either empty or contains an opponent's piece
-    std::shared_ptr<Piece> destinationPiece = board.getPiece(to);
-    if (destinationPiece == nullptr || destinationPiece->getColor() != color) {
-        return true;
-    }
-
-    return false;
+    // ...and either empty or contain an opponent's piece
+    return !(board.byColor[static_cast<int>(color)] & Bitboards::squareBB(to.index()));
 }
 
 char Bishop::getSymbol() const {
@@ -270,39 +114,6 @@ std::string Bishop::getPieceType() const {
     return "Bishop";
 }
 
-std::vector<Position>& Bishop::generatePossibleMoves(const Board& board) {
-    moves.clear();
-
-    // Directions: diagonal
-    static std::vector<std::pair<int, int>> directions = {
-        {1, 1}, {-1, -1}, {1, -1}, {-1, 1}
-    };
-
-    for (const auto& dir : directions) {
-        for (int i = 1; i < 8; ++i) {
-            Position newPos = { position.row + i * dir.first, position.col + i * dir.second };
-            if (!board.isValidPosition(newPos)) {
-                break;
-            }
-            std::shared_ptr<Piece> pieceAtNewPos = board.getPiece(newPos);
-            if (pieceAtNewPos == nullptr) {
-                moves.push_back(newPos);
-            } else {
-                if (pieceAtNewPos->getColor() != color) {
-                    moves.push_back(newPos);
-                }
-                break; // Stop if another piece is encountered
-            }
-        }
-    }
-
-    if (true) {
-        moves = filterCheckMoves(board, moves);
-    }
-
-    return moves;
-}
-
 Knight::Knight(Color color, Position pos) : Piece(PieceType::KNIGHT, color, pos) {}
 
 bool Knight::isValidMove(const Board& board, Position from, Position to) const {
@@ -328,60 +139,16 @@ std::string Knight::getPieceType() const {
     return "Knight";
 }
 
-std::vector<Position>& Knight::generatePossibleMoves(const Board& board) {
-    moves.clear();
-    static std::vector<std::pair<int, int>> moveOffsets = {
-        {2, 1}, {2, -1}, {-2, 1}, {-2, -1},
-        {1, 2}, {1, -2}, {-1, 2}, {-1, -2}
-    };
-
-    for (const auto& offset : moveOffsets) {
-        Position newPos = { position.row + offset.first, position.col + offset.second };
-        if (board.isValidPosition(newPos)) {
-            std::shared_ptr<Piece> pieceAtNewPos = board.getPiece(newPos);
-            if (pieceAtNewPos == nullptr || pieceAtNewPos->getColor() != color) {
-                moves.push_back(newPos);
-            }
-        }
-    }
-
-    if (true) {
-        moves = filterCheckMoves(board, moves);
-    }
-
-    return moves;
-}
-
 Rook::Rook(Color color, Position pos) : Piece(PieceType::ROOK, color, pos) {}
 
 bool Rook::isValidMove(const Board& board, Position from, Position to) const {
-    int rowDiff = std::abs(from.row - to.row);
-    int colDiff = std::abs(from.col - to.col);
-
-    // Rook moves horizontally or vertically
-    if (rowDiff != 0 && colDiff != 0) {
+    // The destination must be reachable past any blockers...
+    if (!board.isValidPosition(from) || !board.isValidPosition(to)
+        || !(Bitboards::rookAttacks(from.index(), board.occupied()) & Bitboards::squareBB(to.index()))) {
         return false;
     }
-
-    // Determine step direction
-    int rowStep = (to.row - from.row) == 0 ? 0 : (to.row - from.row) / rowDiff;
-    int colStep = (to.col - from.col) == 0 ? 0 : (to.col - from.col) / colDiff;
-
-    // Check for obstacles
-    for (int i = 1; i < std::max(rowDiff, colDiff); ++i) {
-        Position intermediatePos = { from.row + i * rowStep, from.col + i * colStep };
-        if (board.getPiece(intermediatePos) != nullptr) {
-            return false;
-        }
-    }
-
-    // Ensure destination is either empty or contains an opponent's piece
-    std::shared_ptr<Piece> destinationPiece = board.getPiece(to);
-    if (destinationPiece == nullptr || destinationPiece->getColor() != color) {
-        return true;
-    }
-
-    return false;
+    // ...and either empty or contain an opponent's piece
+    return !(board.byColor[static_cast<int>(color)] & Bitboards::squareBB(to.index()));
 }
 
 char Rook::getSymbol() const {
@@ -392,39 +159,6 @@ std::string Rook::getPieceType() const {
     return "Rook";
 }
 
-std::vector<Position>& Rook::generatePossibleMoves(const Board& board) {
-    moves.clear();
-
-    // Directions: horizontal and vertical
-    static std::vector<std::pair<int, int>> directions = {
-        {1, 0}, {-1, 0}, {0, 1}, {0, -1}
-    };
-
-    for (const auto& dir : directions) {
-        for (int i = 1; i < 8; ++i) {
-            Position newPos = { position.row + i * dir.first, position.col + i * dir.second };
-            if (!board.isValidPosition(newPos)) {
-                break;
-            }
-            std::shared_ptr<Piece> pieceAtNewPos = board.getPiece(newPos);
-            if (pieceAtNewPos == nullptr) {
-                moves.push_back(newPos);
-            } else {
-                if (pieceAtNewPos->getColor() != color) {
-                    moves.push_back(newPos);
-                }
-                break; // Stop if another piece is encountered
-            }
-        }
-    }
-
-    if (true) {
-        moves = filterCheckMoves(board, moves);
-    }
-
-    return moves;
-}
-
 Pawn::Pawn(Color color, Position pos) : Piece(PieceType::PAWN, color, pos) {}
 
 bool Pawn::isValidMove(const Board& board, Position from, Position to) const {
@@ -449,31 +183,3 @@ std::string Pawn::getPieceType() const {
     return "Pawn";
 }
 
-std::vector<Position>& Pawn::generatePossibleMoves(const Board& board) {
-    moves.clear();
-    int direction = (color == Color::WHITE) ? 1 : -1;
-    Position forwardPos = { position.row + direction, position.col };
-    if (board.isValidPosition(forwardPos) && board.getPiece(forwardPos) == nullptr) {
-        moves.push_back(forwardPos);
-        if ((color == Color::WHITE && position.row == 1) || (color == Color::BLACK && position.row == 6)) {
-            Position doubleForwardPos = { position.row + 2 * direction, position.col };
-            if (board.isValidPosition(doubleForwardPos) && board.getPiece(doubleForwardPos) == nullptr) {
-                moves.push_back(doubleForwardPos);
-            }
-        }
-    }
-    Position captureLeft = { position.row + direction, position.col - 1 };
-    Position captureRight = { position.row + direction, position.col + 1 };
-    if (board.isValidPosition(captureLeft) && board.getPiece(captureLeft) != nullptr && board.getPiece(captureLeft)->getColor() != color) {
-        moves.push_back(captureLeft);
-    }
-    if (board.isValidPosition(captureRight) && board.getPiece(captureRight) != nullptr && board.getPiece(captureRight)->getColor() != color) {
-        moves.push_back(captureRight);
-    }
-
-    if (true) {
-        moves = filterCheckMoves(board, moves);
-    }
-
-    return moves;
-}
@@ -0,0 +1,62 @@
+#include "PieceArena.h"
+#include <cstdint>
+#include <new>
+
+namespace {
+
+// A thread's free blocks, linked through their first bytes
+struct FreeList {
+    struct Node {
+        Node* next;
+    };
+
+    Node* head = nullptr;
+    size_t count = 0;
+
+    ~FreeList() {
+        while (head) {
+            Node* next = head->next;
+            ::operator delete(head);
+            head = next;
+        }
+        // pieces destroyed after this (static boards) go straight back to the heap
+        count = SIZE_MAX;
+    }
+};
+
+thread_local FreeList freeBlocks;
+
+} // namespace
+
+std::shared_ptr<Piece> PieceArena::create(PieceType type, Color color, Position pos) {
+    switch (type) {
+        case PieceType::ROOK:   return make<Rook>(color, pos);
+        case PieceType::KNIGHT: return make<Knight>(color, pos);
+        case PieceType::BISHOP: return make<Bishop>(color, pos);
+        case PieceType::KING:   return make<King>(color, pos);
+        case PieceType::PAWN:   return make<Pawn>(color, pos);
+        default:                return make<Queen>(color, pos);
+    }
+}
+
+void* PieceArena::allocateBlock(size_t bytes) {
+    if (bytes > BlockSize) {
+        return ::operator new(bytes);
+    }
+    if (FreeList::Node* node = freeBlocks.head) {
+        freeBlocks.head = node->next;
+        --freeBlocks.count;
+        return node;
+    }
+    return ::operator new(BlockSize);
+}
+
+void PieceArena::freeBlock(void* block, size_t bytes) {
+    // a block made on another thread is still a plain BlockSize block, so any list can keep it
+    if (bytes > BlockSize || freeBlocks.count >= MaxFreeBlocks) {
+        ::operator delete(block);
+        return;
+    }
+    freeBlocks.head = new (block) FreeList::Node{ freeBlocks.head };
+    ++freeBlocks.count;
+}
@@ -29,7 +29,8 @@ bool Player::makeMove(Board& board, Position from, Position to) {
 std::vector<Move> Player::generateAllPossibleMoves(const Board& board) const {
     std::vector<Move> allMoves;
     for (std::shared_ptr<Piece> piece : pieces) {
-        std::vector<Position> possibleMoves = piece->generatePossibleMoves(board);
+        std::vector<Position> possibleMoves;
+        piece->generateMoves(board, possibleMoves);
         for (const Position& pos : possibleMoves) {
             allMoves.emplace_back(piece->getPosition(), pos, piece, board.getPiece(pos));
         }
@@ -0,0 +1,128 @@
+#include "PolyglotBook.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+uint64_t readBigEndian(const unsigned char* bytes, int size) {
+    uint64_t value = 0;
+    for (int i = 0; i < size; ++i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+} // namespace
+
+PolyglotBook::PolyglotBook(const std::string& path) {
+    open(path);
+}
+
+bool PolyglotBook::open(const std::string& path) {
+    file.close();
+    count = 0;
+    if (!file.openReadOnly(path)) {
+        return false;
+    }
+    if (file.size() == 0 || file.size() % ENTRY_SIZE != 0) {
+        std::cout << "opening book: " << path << " is not a Polyglot book" << std::endl;
+        file.close();
+        return false;
+    }
+    count = file.size() / ENTRY_SIZE;
+    return true;
+}
+
+uint64_t PolyglotBook::keyAt(size_t index) const {
+    return readBigEndian(file.data() + index * ENTRY_SIZE, 8);
+}
+
+std::string PolyglotBook::decodeMove(const Board& board, uint16_t move) {
+    int to = move & 63;
+    const int from = (move >> 6) & 63;
+    const int promotion = (move >> 12) & 7;
+
+    if (typeOf(board.pieceOn(from)) == PieceType::KING) {
+        // e1h1 is e1g1, e1a1 is e1c1, and the same on the eighth rank
+        if (from == 4 && (to == 7 || to == 0)) {
+            to = to == 7 ? 6 : 2;
+        } else if (from == 60 && (to == 63 || to == 56)) {
+            to = to == 63 ? 62 : 58;
+        }
+    }
+
+    std::string uci;
+    uci += static_cast<char>('a' + from % 8);
+    uci += static_cast<char>('1' + from / 8);
+    uci += static_cast<char>('a' + to % 8);
+    uci += static_cast<char>('1' + to / 8);
+    if (promotion >= 1 && promotion <= 4) {
+        uci += " nbrq"[promotion];
+    }
+    return uci;
+}
+
+std::vector<PolyglotBook::BookMove> PolyglotBook::moves(const Board& board) const {
+    std::vector<BookMove> result;
+    if (!isOpen()) {
+        return result;
+    }
+    const uint64_t key = board.polyglotKey();
+
+    // first entry with the key
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (keyAt(middle) < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    for (size_t i = low; i < count && keyAt(i) == key; ++i) {
+        const unsigned char* entry = file.data() + i * ENTRY_SIZE;
+        const uint16_t move = static_cast<uint16_t>(readBigEndian(entry + 8, 2));
+        const uint16_t weight = static_cast<uint16_t>(readBigEndian(entry + 10, 2));
+        // a key collision or a broken book can suggest anything, so only legal moves count
+        const int from = (move >> 6) & 63;
+        std::string uci = decodeMove(board, move);
+        const int to = (uci[2] - 'a') + (uci[3] - '1') * 8;
+        if (board.pieceOn(from) == pieceTypeWithColor::empty || colorOf(board.pieceOn(from)) != board.getSideToMove()
+            || !(board.legalTargets(from) & Bitboards::squareBB(to))) {
+            continue;
+        }
+        result.push_back({ std::move(uci), weight });
+    }
+    return result;
+}
+
+std::string PolyglotBook::probe(const Board& board, Selection selection) {
+    const std::vector<BookMove> candidates = moves(board);
+    uint32_t total = 0;
+    for (const BookMove& candidate : candidates) {
+        total += candidate.weight;
+    }
+    if (total == 0) {
+        return "";
+    }
+
+    if (selection == Selection::BEST) {
+        return std::max_element(candidates.begin(), candidates.end(), [](const BookMove& a, const BookMove& b) {
+            return a.weight < b.weight;
+        })->move;
+    }
+
+    uint32_t pick;
+    {
+        std::lock_guard<std::mutex> lock(rngMutex);
+        pick = static_cast<uint32_t>(rng() % total);
+    }
+    for (const BookMove& candidate : candidates) {
+        if (pick < candidate.weight) {
+            return candidate.move;
+        }
+        pick -= candidate.weight;
+    }
+    return candidates.back().move;
+}
@@ -0,0 +1,378 @@
+// batch.cpp
+// Headless analysis of a file of positions (one FEN or EPD record per line) with a fixed
+// depth, node or time budget per position. The positions are shared out between N engine
+// workers and the results are written as JSON lines in input order. Progress is saved to a
+// checkpoint file as results are written, so an interrupted run can be picked up with
+// --resume. Every position is searched from a cleared engine (ucinewgame), so a result doesn't
+// depend on which positions its worker happened to analyse before it. Throughput
+// (positions/sec, nodes/sec) is reported as it goes and at the end.
+//
+// usage: batch <positions> <results.jsonl> [--engines N] [--depth D | --nodes N | --movetime MS]
+//              [--engine PATH] [--checkpoint FILE] [--resume]
+
+#include "Board.h"
+#include "EngineBackend.h"
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Results may run this many lines ahead of the oldest unfinished position before workers wait
+static const size_t REORDER_WINDOW = 4096;
+// How often progress is printed and the checkpoint brought up to date
+static const auto REPORT_INTERVAL = std::chrono::seconds(5);
+
+struct Settings {
+    std::string inputPath;
+    std::string outputPath;
+    std::string checkpointPath;
+    std::string engineLocation = defaultEngineLocation();
+    SearchLimits limits = SearchLimits::atDepth(12);
+    int engines = 1;
+    bool resume = false;
+};
+
+// Where an interrupted run got to: every input line before `lines` has its result in the
+// first `outputBytes` bytes of the output
+struct Checkpoint {
+    uint64_t lines = 0;
+    uint64_t outputBytes = 0;
+};
+
+static bool readCheckpoint(const std::string& path, Checkpoint& checkpoint) {
+    std::ifstream in(path);
+    return static_cast<bool>(in >> checkpoint.lines >> checkpoint.outputBytes);
+}
+
+// Written to a temporary file and renamed over the old one, so a crash never leaves half a checkpoint
+static void writeCheckpoint(const std::string& path, const Checkpoint& checkpoint) {
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        out << checkpoint.lines << ' ' << checkpoint.outputBytes << std::endl;
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::cout << "can't update checkpoint " << path << ": " << error.message() << std::endl;
+    }
+}
+
+static std::string jsonString(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out + "\"";
+}
+
+// Split a FEN or EPD record into a full FEN and the EPD id, if any. False for blank and
+// comment lines.
+static bool parseRecord(const std::string& line, std::string& fen, std::string& id) {
+    std::istringstream fields(line);
+    std::string placement, side, castling, enPassant;
+    if (!(fields >> placement) || placement[0] == '#') {
+        return false;
+    }
+    fields >> side >> castling >> enPassant;
+
+    std::string halfmove = "0", fullmove = "1";
+    std::string rest;
+    std::getline(fields, rest);
+    std::istringstream restFields(rest);
+    std::string first, second;
+    auto isNumber = [](const std::string& token) {
+        return std::all_of(token.begin(), token.end(), [](unsigned char c) { return std::isdigit(c) != 0; });
+    };
+    if (restFields >> first >> second && isNumber(first) && isNumber(second)) {
+        // FEN: the move clocks follow
+        halfmove = first;
+        fullmove = second;
+    } else {
+        // EPD: "opcode operands;" pairs, of which hmvc, fmvn and id matter here
+        std::istringstream operations(rest);
+        std::string operation;
+        while (std::getline(operations, operation, ';')) {
+            std::istringstream parts(operation);
+            std::string opcode;
+            parts >> opcode;
+            std::string operand;
+            std::getline(parts >> std::ws, operand);
+            if (opcode == "hmvc") {
+                halfmove = operand;
+            } else if (opcode == "fmvn") {
+                fullmove = operand;
+            } else if (opcode == "id") {
+                if (operand.size() >= 2 && operand.front() == '"' && operand.back() == '"') {
+                    operand = operand.substr(1, operand.size() - 2);
+                }
+                id = operand;
+            }
+        }
+    }
+    fen = placement + ' ' + side + ' ' + castling + ' ' + enPassant + ' ' + halfmove + ' ' + fullmove;
+    return true;
+}
+
+// A position the engine can search: legal placement, one king each, side not to move not in check
+static bool isSearchable(Board& board, const std::string& fen) {
+    if (!board.loadFEN(fen)) {
+        return false;
+    }
+    for (Color color : { Color::WHITE, Color::BLACK }) {
+        if (Bitboards::popcount(board.pieces(color, PieceType::KING)) != 1) {
+            return false;
+        }
+    }
+    return !board.isCheck(board.getOppositeColor());
+}
+
+static std::string resultLine(uint64_t lineNumber, const std::string& fen, const std::string& id, const Analysis& analysis) {
+    std::ostringstream json;
+    json << "{\"line\":" << lineNumber + 1 << ",\"fen\":" << jsonString(fen);
+    if (!id.empty()) {
+        json << ",\"id\":" << jsonString(id);
+    }
+    json << ",\"bestmove\":" << jsonString(analysis.bestMove);
+    if (!analysis.ponderMove.empty()) {
+        json << ",\"ponder\":" << jsonString(analysis.ponderMove);
+    }
+    json << ",\"depth\":" << analysis.depth << ",\"score\":{\"" << (analysis.mate ? "mate" : "cp") << "\":" << analysis.score
+         << "},\"nodes\":" << analysis.nodes << ",\"pv\":[";
+    for (size_t i = 0; i < analysis.pv.size(); ++i) {
+        json << (i ? "," : "") << jsonString(analysis.pv[i]);
+    }
+    json << "]}";
+    return json.str();
+}
+
+static std::string errorLine(uint64_t lineNumber, const std::string& fen, const std::string& id, const std::string& error) {
+    std::ostringstream json;
+    json << "{\"line\":" << lineNumber + 1 << ",\"fen\":" << jsonString(fen);
+    if (!id.empty()) {
+        json << ",\"id\":" << jsonString(id);
+    }
+    json << ",\"error\":" << jsonString(error) << "}";
+    return json.str();
+}
+
+// Hands out input lines to the workers and writes their results back in input order
+class BatchRun {
+public:
+    BatchRun(std::istream& input, std::ofstream& output, const Settings& settings, const Checkpoint& start)
+        : input(input), output(output), settings(settings), nextLine(start.lines), nextToWrite(start.lines),
+          outputBytes(start.outputBytes) {}
+
+    // The next input line to analyse; false when the input is used up
+    bool take(uint64_t& lineNumber, std::string& line) {
+        std::unique_lock<std::mutex> lock(mutex);
+        // don't let results pile up behind one slow position
+        room.wait(lock, [&] { return nextLine < nextToWrite + REORDER_WINDOW; });
+        if (!std::getline(input, line)) {
+            return false;
+        }
+        lineNumber = nextLine++;
+        return true;
+    }
+
+    // Record the result for an input line ("" for a line with no position)
+    void finish(uint64_t lineNumber, std::string result, long long nodes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.emplace(lineNumber, std::move(result));
+        if (nodes > 0) {
+            totalNodes += static_cast<uint64_t>(nodes);
+        }
+        bool wrote = false;
+        for (auto it = pending.begin(); it != pending.end() && it->first == nextToWrite; it = pending.erase(it)) {
+            if (!it->second.empty()) {
+                output << it->second << '\n';
+                outputBytes += it->second.size() + 1;
+                ++positions;
+            }
+            ++nextToWrite;
+            wrote = true;
+        }
+        if (wrote) {
+            room.notify_all();
+        }
+        if (Clock::now() - lastReport >= REPORT_INTERVAL) {
+            saveProgress();
+            report();
+            lastReport = Clock::now();
+        }
+    }
+
+    void complete() {
+        std::lock_guard<std::mutex> lock(mutex);
+        saveProgress();
+        report();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void saveProgress() {
+        output.flush();
+        if (output) {
+            writeCheckpoint(settings.checkpointPath, Checkpoint{ nextToWrite, outputBytes });
+        }
+    }
+
+    void report() const {
+        double seconds = std::max(std::chrono::duration<double>(Clock::now() - started).count(), 1e-9);
+        std::cout << "line " << nextToWrite << ": " << positions << " positions in " << seconds << " s ("
+                  << positions / seconds << " positions/sec, " << static_cast<uint64_t>(totalNodes / seconds)
+                  << " nodes/sec)" << std::endl;
+    }
+
+    std::istream& input;
+    std::ofstream& output;
+    const Settings& settings;
+    uint64_t nextLine;                          // input line handed out next
+    uint64_t nextToWrite;                       // input line whose result is written next
+    uint64_t outputBytes;
+    std::map<uint64_t, std::string> pending;    // results waiting for earlier lines
+    uint64_t positions = 0;                     // analysed in this run
+    uint64_t totalNodes = 0;
+    const Clock::time_point started = Clock::now();
+    Clock::time_point lastReport = Clock::now();
+    std::mutex mutex;
+    std::condition_variable room;
+};
+
+static void runWorker(BatchRun& run, const Settings& settings) {
+    std::unique_ptr<EngineBackend> engine;
+    Board board;
+    uint64_t lineNumber;
+    std::string line;
+    while (run.take(lineNumber, line)) {
+        std::string fen, id;
+        if (!parseRecord(line, fen, id)) {
+            run.finish(lineNumber, "", 0);
+            continue;
+        }
+        if (!isSearchable(board, fen)) {
+            run.finish(lineNumber, errorLine(lineNumber, fen, id, "invalid position"), 0);
+            continue;
+        }
+        try {
+            if (!engine) {
+                engine = std::make_unique<EngineBackend>(settings.engineLocation);
+                engine->setLogging(false);
+            } else {
+                // forget the hash and history left by the previous position
+                engine->newGame();
+            }
+            Analysis analysis = engine->analyze(board.toFEN(), {}, settings.limits);
+            run.finish(lineNumber, resultLine(lineNumber, fen, id, analysis), analysis.nodes);
+        } catch (const std::exception& e) {
+            // start a fresh engine for the next position
+            engine.reset();
+            run.finish(lineNumber, errorLine(lineNumber, fen, id, e.what()), 0);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Settings settings;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--engines" && i + 1 < argc) {
+            settings.engines = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--depth" && i + 1 < argc) {
+            settings.limits = SearchLimits::atDepth(std::stoi(argv[++i]));
+        } else if (arg == "--movetime" && i + 1 < argc) {
+            settings.limits = SearchLimits::forTime(std::stoi(argv[++i]));
+        } else if (arg == "--nodes" && i + 1 < argc) {
+            settings.limits = SearchLimits();
+            settings.limits.nodes = std::stoll(argv[++i]);
+        } else if (arg == "--engine" && i + 1 < argc) {
+            settings.engineLocation = argv[++i];
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            settings.checkpointPath = argv[++i];
+        } else if (arg == "--resume") {
+            settings.resume = true;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() != 2) {
+        std::cout << "usage: batch <positions> <results.jsonl> [--engines N] [--depth D | --nodes N | --movetime MS]\n"
+                     "             [--engine PATH] [--checkpoint FILE] [--resume]" << std::endl;
+        return 1;
+    }
+    settings.inputPath = paths[0];
+    settings.outputPath = paths[1];
+    if (settings.checkpointPath.empty()) {
+        settings.checkpointPath = settings.outputPath + ".checkpoint";
+    }
+
+    std::ifstream input(settings.inputPath);
+    if (!input) {
+        std::cout << "can't read " << settings.inputPath << std::endl;
+        return 1;
+    }
+
+    // Pick up after the last checkpoint: drop any results written after it and skip the
+    // input lines it covers
+    Checkpoint start;
+    if (settings.resume) {
+        // starting over would truncate the results the run was asked to keep
+        if (!readCheckpoint(settings.checkpointPath, start)) {
+            std::cout << "can't read checkpoint " << settings.checkpointPath << "; not resuming" << std::endl;
+            return 1;
+        }
+        std::error_code error;
+        if (std::filesystem::file_size(settings.outputPath, error) < start.outputBytes || error) {
+            std::cout << settings.outputPath << " is shorter than the checkpoint says; not resuming" << std::endl;
+            return 1;
+        }
+        std::filesystem::resize_file(settings.outputPath, start.outputBytes);
+        std::string skipped;
+        for (uint64_t i = 0; i < start.lines && std::getline(input, skipped); ++i) {
+        }
+        std::cout << "resuming at line " << start.lines + 1 << std::endl;
+    }
+    std::ofstream output(settings.outputPath, settings.resume ? std::ios::app : std::ios::trunc);
+    if (!output) {
+        std::cout << "can't write " << settings.outputPath << std::endl;
+        return 1;
+    }
+
+    BatchRun run(input, output, settings, start);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < settings.engines; ++i) {
+        workers.emplace_back(runWorker, std::ref(run), std::cref(settings));
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    run.complete();
+    return 0;
+}
@@ -0,0 +1,252 @@
+// perft.cpp
+// Counts the leaf nodes of the move tree to a fixed depth using the project's Board
+// (generateLegalMoves + makeMove/unmakeMove) over a standard suite of positions, and
+// reports throughput. When built with PERFT_WITH_STOCKFISH it can also diff per-root-move
+// counts against the vendored engine. With --threads the root moves are shared out between
+// workers, each on its own Board built from a snapshot of the root.
+//
+// usage: perft [depth] [--fen "<fen>"] [--divide] [--compare] [--threads N]
+
+#include "Board.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef PERFT_WITH_STOCKFISH
+// perft.h brings in Stockfish's bitboard.h and position.h; they're not named here since our
+// Bitboard.h and Position.h would shadow them on case-insensitive file systems
+#include "movegen.h"
+#include "perft.h"
+#include "uci.h"
+#endif
+
+struct PerftCase {
+    const char* name;
+    const char* fen;
+    std::vector<uint64_t> expected; // expected[d - 1] is the node count at depth d
+    int defaultDepth;
+};
+
+// Reference positions and node counts from the Chess Programming Wiki "Perft Results" page
+static const std::vector<PerftCase> suite = {
+    {"startpos", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+     {20, 400, 8902, 197281, 4865609, 119060324}, 5},
+    {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+     {48, 2039, 97862, 4085603, 193690690}, 4},
+    {"position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+     {14, 191, 2812, 43238, 674624, 11030083}, 5},
+    {"position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+     {6, 264, 9467, 422333, 15833292}, 4},
+    {"position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+     {44, 1486, 62379, 2103487, 89941194}, 4},
+    {"position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+     {46, 2079, 89890, 3894594, 164075551}, 4},
+};
+
+static uint64_t perft(Board& board, int depth) {
+    MoveList moves;
+    board.generateLegalMoves(board.getSideToMove(), moves);
+    if (depth == 1) {
+        return moves.size();
+    }
+    uint64_t nodes = 0;
+    for (PackedMove move : moves) {
+        board.makeMove(move);
+        nodes += perft(board, depth - 1);
+        board.unmakeMove();
+    }
+    return nodes;
+}
+
+// Same count with the root moves split across threads
+static uint64_t parallelPerft(const Board& board, int depth, int threads) {
+    MoveList moves;
+    board.generateLegalMoves(board.getSideToMove(), moves);
+    if (depth == 1 || threads <= 1) {
+        Board copy(board.snapshot());
+        return perft(copy, depth);
+    }
+    const BoardSnapshot root = board.snapshot();
+    std::atomic<int> next{0};
+    std::atomic<uint64_t> nodes{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            Board local(root);
+            uint64_t count = 0;
+            for (int i = next++; i < moves.size(); i = next++) {
+                local.makeMove(moves[i]);
+                count += perft(local, depth - 1);
+                local.unmakeMove();
+            }
+            nodes += count;
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    return nodes;
+}
+
+// Node count below each root move
+static std::map<std::string, uint64_t> divide(Board& board, int depth) {
+    std::map<std::string, uint64_t> counts;
+    MoveList moves;
+    board.generateLegalMoves(board.getSideToMove(), moves);
+    for (PackedMove move : moves) {
+        board.makeMove(move);
+        counts[move.toUci()] = depth > 1 ? perft(board, depth - 1) : 1;
+        board.unmakeMove();
+    }
+    return counts;
+}
+
+#ifdef PERFT_WITH_STOCKFISH
+static std::map<std::string, uint64_t> stockfishDivide(const std::string& fen, int depth) {
+    namespace SF = Stockfish;
+    SF::StateInfo rootState, childState;
+    SF::Position pos;
+    pos.set(fen, false, &rootState);
+
+    std::map<std::string, uint64_t> counts;
+    for (const auto& m : SF::MoveList<SF::LEGAL>(pos)) {
+        uint64_t count = 1;
+        if (depth > 1) {
+            pos.do_move(m, childState);
+            // Benchmark::perft<false> expects depth >= 2, so count the last ply directly
+            count = depth == 2 ? SF::MoveList<SF::LEGAL>(pos).size() : SF::Benchmark::perft<false>(pos, depth - 1);
+            pos.undo_move(m);
+        }
+        counts[SF::UCIEngine::move(m, false)] = count;
+    }
+    return counts;
+}
+
+// Print every root move whose count differs; returns true if both sides agree
+static bool compareWithStockfish(Board& board, const std::string& fen, int depth) {
+    std::map<std::string, uint64_t> ours = divide(board, depth);
+    std::map<std::string, uint64_t> theirs = stockfishDivide(fen, depth);
+    bool same = true;
+    for (const auto& [move, count] : theirs) {
+        auto it = ours.find(move);
+        if (it == ours.end()) {
+            std::cout << "  missing move " << move << " (stockfish: " << count << ")" << std::endl;
+            same = false;
+        } else if (it->second != count) {
+            std::cout << "  " << move << ": " << it->second << " (stockfish: " << count << ")" << std::endl;
+            same = false;
+        }
+    }
+    for (const auto& [move, count] : ours) {
+        if (!theirs.count(move)) {
+            std::cout << "  illegal move " << move << " (ours: " << count << ")" << std::endl;
+            same = false;
+        }
+    }
+    return same;
+}
+#endif
+
+// A whole-number argument of at least 1 (a depth or a thread count)
+static bool parseCount(const std::string& text, int& count) {
+    size_t used = 0;
+    int value;
+    try {
+        value = std::stoi(text, &used);
+    } catch (const std::exception&) {
+        return false;
+    }
+    if (used != text.size() || value < 1) {
+        return false;
+    }
+    count = value;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int depth = 0;
+    bool showDivide = false;
+    bool compare = false;
+    int threads = 1;
+    std::string customFen;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--fen" && i + 1 < argc) {
+            customFen = argv[++i];
+        } else if (arg == "--divide") {
+            showDivide = true;
+        } else if (arg == "--compare") {
+            compare = true;
+        } else if (arg == "--threads" && i + 1 < argc && parseCount(argv[i + 1], threads)) {
+            ++i;
+        } else if (!parseCount(arg, depth)) {
+            std::cout << "usage: perft [depth] [--fen \"<fen>\"] [--divide] [--compare] [--threads N]\n"
+                         "depth and N are whole numbers of at least 1" << std::endl;
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+
+#ifdef PERFT_WITH_STOCKFISH
+    Stockfish::Bitboards::init();
+    Stockfish::Position::init();
+#else
+    if (compare) {
+        std::cout << "--compare needs a build with PERFT_STOCKFISH=ON" << std::endl;
+        return 1;
+    }
+#endif
+
+    std::vector<PerftCase> cases = suite;
+    if (!customFen.empty()) {
+        cases = { {"custom", customFen.c_str(), {}, depth > 0 ? depth : 4} };
+    }
+
+    bool allPassed = true;
+    uint64_t totalNodes = 0;
+    double totalSeconds = 0;
+    Board board;
+    for (const PerftCase& test : cases) {
+        int d = depth > 0 ? depth : test.defaultDepth;
+        if (!board.loadFEN(test.fen)) {
+            std::cout << test.name << ": invalid FEN" << std::endl;
+            allPassed = false;
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t nodes = threads > 1 ? parallelPerft(board, d, threads) : perft(board, d);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        totalNodes += nodes;
+        totalSeconds += seconds;
+
+        std::cout << test.name << " depth " << d << ": " << nodes << " nodes in " << seconds * 1000 << " ms ("
+                  << static_cast<uint64_t>(nodes / std::max(seconds, 1e-9)) << " nodes/sec)";
+        if (static_cast<size_t>(d) <= test.expected.size()) {
+            bool passed = nodes == test.expected[d - 1];
+            allPassed = allPassed && passed;
+            std::cout << (passed ? " ok" : " MISMATCH, expected " + std::to_string(test.expected[d - 1]));
+        }
+        std::cout << std::endl;
+
+        if (showDivide) {
+            for (const auto& [move, count] : divide(board, d)) {
+                std::cout << "  " << move << ": " << count << std::endl;
+            }
+        }
+#ifdef PERFT_WITH_STOCKFISH
+        if (compare && !compareWithStockfish(board, test.fen, d)) {
+            allPassed = false;
+        }
+#endif
+    }
+
+    std::cout << "total: " << totalNodes << " nodes in " << totalSeconds * 1000 << " ms ("
+              << static_cast<uint64_t>(totalNodes / std::max(totalSeconds, 1e-9)) << " nodes/sec)" << std::endl;
+    return allPassed ? 0 : 1;
+}